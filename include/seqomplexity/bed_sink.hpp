@@ -0,0 +1,187 @@
+#pragma once
+
+#include <algorithm>
+#include <charconv>
+#include <cstddef>
+#include <memory>
+#include <string>
+#include <string_view>
+
+#include <seqomplexity/output_file.hpp>
+#include <seqomplexity/score_format.hpp>
+#include <seqomplexity/score_sink.hpp>
+
+namespace seqomplexity
+{
+
+// one line per base with its position: chrom, start, end and score separated
+// by tabs, start is 0-based and end exclusive like in BED. compressed with
+// BGZF the output can be indexed with tabix -p bed.
+class bed_sink : public score_sink
+{
+public:
+    explicit bed_sink(std::unique_ptr<byte_output> out, int precision = default_precision) :
+        out(std::move(out)),
+        precision(precision)
+    {}
+
+    void begin_record(std::string const & name) override
+    {
+        chrom = name;
+        position = 0;
+    }
+
+    void begin_region(std::string const & name, size_t start, size_t) override
+    {
+        chrom = name;
+        position = start;
+    }
+
+    void write(float const * scores, size_t n) override
+    {
+        size_t line_size = chrom.size() + 2 * max_position_chars + max_score_chars + 3;
+        text.resize(n * line_size);
+        char * p = text.data();
+        for (size_t i = 0; i < n; i++)
+        {
+            p = std::copy(chrom.begin(), chrom.end(), p);
+            *p++ = '\t';
+            p = std::to_chars(p, p + max_position_chars, position).ptr;
+            *p++ = '\t';
+            p = std::to_chars(p, p + max_position_chars, ++position).ptr;
+            *p++ = '\t';
+            p = format_score(p, scores[i], precision);
+        }
+        text.resize(p - text.data());
+        out->write(text);
+    }
+
+    void end_record() override
+    {}
+
+    void finish() override
+    {
+        out->finish();
+    }
+
+private:
+    static constexpr size_t max_position_chars = 20;
+
+    std::unique_ptr<byte_output> out;
+    int precision;
+    std::string chrom{};
+    size_t position{0};
+    std::string text{};
+};
+
+// bedGraph: consecutive bases with the same score are merged into one line
+// with chrom, start, end and score. with a precision the scores are compared
+// as they are printed, otherwise they have to be exactly equal.
+class bedgraph_sink : public score_sink
+{
+public:
+    explicit bedgraph_sink(std::unique_ptr<byte_output> out, int precision = default_precision) :
+        out(std::move(out)),
+        precision(precision)
+    {}
+
+    void begin_record(std::string const & name) override
+    {
+        begin_region(name, 0, 0);
+    }
+
+    void begin_region(std::string const & name, size_t start, size_t) override
+    {
+        chrom = name;
+        position = start;
+        run_start = start;
+    }
+
+    void write(float const * scores, size_t n) override
+    {
+        for (size_t i = 0; i < n; i++)
+        {
+            if (position == run_start)
+            {
+                start_run(scores[i]);
+            }
+            else if (!same_score(scores[i]))
+            {
+                end_run();
+                start_run(scores[i]);
+            }
+            position++;
+        }
+        if (text.size() >= flush_size)
+        {
+            out->write(text);
+            text.clear();
+        }
+    }
+
+    void end_record() override
+    {
+        if (position > run_start)
+        {
+            end_run();
+        }
+    }
+
+    void finish() override
+    {
+        out->write(text);
+        text.clear();
+        out->finish();
+    }
+
+private:
+    static constexpr size_t flush_size = size_t(1) << 20;
+    static constexpr size_t max_position_chars = 20;
+
+    std::unique_ptr<byte_output> out;
+    int precision;
+    std::string chrom{};
+    size_t position{0};
+    // the current run of equal scores starts at run_start
+    size_t run_start{0};
+    float run_score{0.0f};
+    // the printed run score, only used with a precision
+    char run_text[max_score_chars];
+    char * run_text_end{run_text};
+    std::string text{};
+
+    void start_run(float score)
+    {
+        run_start = position;
+        run_score = score;
+        run_text_end = format_score(run_text, score, precision);
+    }
+
+    bool same_score(float score) const
+    {
+        if (precision == default_precision)
+        {
+            return score == run_score;
+        }
+        char printed[max_score_chars];
+        char * printed_end = format_score(printed, score, precision);
+        return std::string_view(printed, printed_end - printed) == std::string_view(run_text, run_text_end - run_text);
+    }
+
+    void end_run()
+    {
+        size_t old_size = text.size();
+        text.resize(old_size + chrom.size() + 2 * max_position_chars + max_score_chars + 3);
+        char * p = text.data() + old_size;
+        p = std::copy(chrom.begin(), chrom.end(), p);
+        *p++ = '\t';
+        p = std::to_chars(p, p + max_position_chars, run_start).ptr;
+        *p++ = '\t';
+        p = std::to_chars(p, p + max_position_chars, position).ptr;
+        *p++ = '\t';
+        p = std::copy(run_text, run_text_end, p);
+        text.resize(p - text.data());
+    }
+};
+
+} // namespace seqomplexity
@@ -0,0 +1,201 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+
+#include <zlib.h>
+
+#include <seqomplexity/output_file.hpp>
+#include <seqomplexity/work_stealing_pool.hpp>
+
+namespace seqomplexity
+{
+
+// compresses a byte stream into BGZF, the blocked gzip that tabix and htslib
+// can index and seek in. the bytes are cut into blocks of block_data_size,
+// batches of blocks are compressed on a work stealing pool and written in
+// order by the calling thread.
+class bgzf_writer : public byte_output
+{
+public:
+    // the uncompressed size of a block as used by htslib
+    static constexpr size_t block_data_size = 0xff00;
+    static constexpr size_t max_block_size = size_t(1) << 16;
+    static constexpr size_t blocks_per_batch = 64;
+    static constexpr size_t batch_data_size = blocks_per_batch * block_data_size;
+    static constexpr size_t header_size = 18;
+    static constexpr size_t footer_size = 8;
+
+    bgzf_writer(std::unique_ptr<byte_output> out, size_t n_threads, int level = Z_DEFAULT_COMPRESSION) :
+        out(std::move(out)),
+        level(level),
+        max_batches_in_flight(4 * std::max(n_threads, size_t(1))),
+        pool(std::max(n_threads, size_t(1)))
+    {
+        pending.reserve(batch_data_size);
+    }
+
+    using byte_output::write;
+
+    void write(void const * data, size_t n) override
+    {
+        char const * bytes = static_cast<char const *>(data);
+        while (n > 0)
+        {
+            size_t chunk = std::min(n, batch_data_size - pending.size());
+            pending.append(bytes, chunk);
+            bytes += chunk;
+            n -= chunk;
+            if (pending.size() == batch_data_size)
+            {
+                submit_batch();
+            }
+        }
+    }
+
+    // writes the remaining blocks and the empty end of file block
+    void finish() override
+    {
+        submit_batch();
+        while (!batches.empty())
+        {
+            write_front(true);
+        }
+        static constexpr unsigned char eof_block[28] = {
+            0x1f, 0x8b, 0x08, 0x04, 0x00, 0x00, 0x00, 0x00, 0x00, 0xff, 0x06, 0x00, 0x42, 0x43,
+            0x02, 0x00, 0x1b, 0x00, 0x03, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00};
+        out->write(eof_block, sizeof(eof_block));
+        out->finish();
+    }
+
+    // compresses data into one BGZF block and appends it to block.
+    // n must not exceed block_data_size.
+    static void compress_block(char const * data, size_t n, int level, std::string & block)
+    {
+        unsigned char compressed[max_block_size];
+        size_t capacity = max_block_size - header_size - footer_size;
+        size_t size = deflate_raw(data, n, level, compressed, capacity);
+        if (size > capacity)
+        {
+            // incompressible data, stored blocks always fit
+            size = deflate_raw(data, n, 0, compressed, capacity);
+        }
+        size_t block_size = header_size + size + footer_size;
+        unsigned char header[header_size] = {
+            0x1f, 0x8b, 0x08, 0x04, 0x00, 0x00, 0x00, 0x00, 0x00, 0xff, 0x06, 0x00, 0x42, 0x43,
+            0x02, 0x00, uint8_t(block_size - 1), uint8_t((block_size - 1) >> 8)};
+        block.append(reinterpret_cast<char const *>(header), header_size);
+        block.append(reinterpret_cast<char const *>(compressed), size);
+        uint32_t crc = crc32(crc32(0L, Z_NULL, 0), reinterpret_cast<Bytef const *>(data), uInt(n));
+        for (uint32_t value : {crc, uint32_t(n)})
+        {
+            for (size_t i = 0; i < 4; i++)
+            {
+                block.push_back(char(uint8_t(value >> (8 * i))));
+            }
+        }
+    }
+
+private:
+    struct batch
+    {
+        std::string data{};
+        std::string compressed{};
+        std::string error{};
+        std::atomic<bool> ready{false};
+    };
+
+    std::unique_ptr<byte_output> out;
+    int level;
+    size_t max_batches_in_flight;
+    std::string pending{};
+    std::deque<std::unique_ptr<batch>> batches{};
+    std::mutex ready_mutex{};
+    std::condition_variable batch_ready{};
+    // declared last so its workers are joined before the batches are freed
+    work_stealing_pool pool;
+
+    // returns the compressed size, more than capacity if it did not fit
+    static size_t deflate_raw(char const * data, size_t n, int level, unsigned char * out, size_t capacity)
+    {
+        z_stream stream{};
+        if (deflateInit2(&stream, level, Z_DEFLATED, -15, 8, Z_DEFAULT_STRATEGY) != Z_OK)
+        {
+            throw std::runtime_error("could not initialise zlib.");
+        }
+        stream.next_in = reinterpret_cast<Bytef *>(const_cast<char *>(data));
+        stream.avail_in = uInt(n);
+        stream.next_out = out;
+        stream.avail_out = uInt(capacity);
+        int status = deflate(&stream, Z_FINISH);
+        size_t size = capacity - stream.avail_out;
+        deflateEnd(&stream);
+        return status == Z_STREAM_END ? size : capacity + 1;
+    }
+
+    void submit_batch()
+    {
+        if (pending.empty())
+        {
+            return;
+        }
+        std::unique_ptr<batch> b = std::make_unique<batch>();
+        b->data.swap(pending);
+        pending.reserve(batch_data_size);
+        batch & queued = *b;
+        pool.submit([this, &queued](size_t)
+        {
+            try
+            {
+                for (size_t i = 0; i < queued.data.size(); i += block_data_size)
+                {
+                    compress_block(queued.data.data() + i, std::min(block_data_size, queued.data.size() - i), level, queued.compressed);
+                }
+            }
+            catch (std::exception const & e)
+            {
+                queued.error = e.what();
+            }
+            queued.data = std::string();
+            std::lock_guard<std::mutex> lock(ready_mutex);
+            queued.ready = true;
+            batch_ready.notify_all();
+        });
+        batches.push_back(std::move(b));
+        while (!batches.empty() && write_front(batches.size() > max_batches_in_flight))
+        {}
+    }
+
+    // writes the first batch, with wait set it blocks until the batch is
+    // compressed. returns false if it was not compressed yet.
+    bool write_front(bool wait)
+    {
+        batch & front = *batches.front();
+        if (wait)
+        {
+            std::unique_lock<std::mutex> lock(ready_mutex);
+            batch_ready.wait(lock, [&]() { return front.ready.load(); });
+        }
+        else if (!front.ready)
+        {
+            return false;
+        }
+        if (!front.error.empty())
+        {
+            throw std::runtime_error(front.error);
+        }
+        out->write(front.compressed);
+        batches.pop_front();
+        return true;
+    }
+};
+
+} // namespace seqomplexity
@@ -0,0 +1,551 @@
+#pragma once
+
+#include <algorithm>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <limits>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <unordered_set>
+#include <vector>
+
+#include <zlib.h>
+
+#include <seqomplexity/output_file.hpp>
+#include <seqomplexity/score_sink.hpp>
+#include <seqomplexity/track_format.hpp>
+
+namespace seqomplexity
+{
+
+// writes the nodes of a tree with block_size items per node, the root first
+// and the leaves last, the layout of the chromosome B+ tree and the R-trees
+// of bigWig files. every node is padded to block_size items. an item of an
+// inner level covers a contiguous range of leaf items, write_branch gets the
+// first and the last of them and the offset of the child node.
+template <typename leaf_writer_t, typename branch_writer_t>
+void write_tree_nodes(
+        std::string & out,
+        size_t tree_offset,
+        size_t n_items,
+        size_t block_size,
+        size_t leaf_item_size,
+        size_t branch_item_size,
+        leaf_writer_t write_leaf,
+        branch_writer_t write_branch)
+{
+    // number of nodes of every level, the leaves first
+    std::vector<size_t> nodes{std::max(size_t(1), (n_items + block_size - 1) / block_size)};
+    while (nodes.back() > 1)
+    {
+        nodes.push_back((nodes.back() + block_size - 1) / block_size);
+    }
+    auto node_size = [&](size_t level)
+    {
+        return 4 + block_size * (level == 0 ? leaf_item_size : branch_item_size);
+    };
+    std::vector<size_t> offsets(nodes.size());
+    size_t offset = tree_offset;
+    for (size_t level = nodes.size(); level-- > 0;)
+    {
+        offsets[level] = offset;
+        offset += nodes[level] * node_size(level);
+    }
+    size_t leaves_per_item(1);
+    for (size_t level = 1; level < nodes.size(); level++)
+    {
+        leaves_per_item *= block_size;
+    }
+    for (size_t level = nodes.size(); level-- > 0;)
+    {
+        size_t n_level_items = level == 0 ? n_items : nodes[level - 1];
+        size_t item_size = level == 0 ? leaf_item_size : branch_item_size;
+        for (size_t node = 0; node < nodes[level]; node++)
+        {
+            size_t first = std::min(n_level_items, node * block_size);
+            size_t last = std::min(n_level_items, first + block_size);
+            out.push_back(char(level == 0));
+            out.push_back('\0');
+            put_le(out, uint16_t(last - first));
+            for (size_t i = first; i < last; i++)
+            {
+                if (level == 0)
+                {
+                    write_leaf(i);
+                }
+                else
+                {
+                    size_t first_leaf = i * leaves_per_item;
+                    size_t last_leaf = std::min(n_items, first_leaf + leaves_per_item) - 1;
+                    write_branch(first_leaf, last_leaf, offsets[level - 1] + i * node_size(level - 1));
+                }
+            }
+            out.append((block_size - (last - first)) * item_size, '\0');
+        }
+        leaves_per_item /= block_size;
+    }
+}
+
+// bigWig file as read by genome browsers and the UCSC tools, written in a
+// single pass. the scores are merged into bedGraph runs of equal values and
+// written as zlib compressed sections of up to items_per_slot runs. the zoom
+// levels are built at the same time: every level sums the bins of the level
+// below into bins reduction_factor times larger. their compressed blocks go
+// to a temporary file as soon as they are complete, only the R-tree entries
+// stay in memory. behind the data and its index every level is copied from
+// there as its record count, its blocks and its index, like the UCSC tools
+// lay it out. the chromosome tree follows, the header is written last.
+class bigwig_sink : public score_sink
+{
+public:
+    static constexpr uint32_t magic = 0x888FFC26;
+    static constexpr uint16_t version = 4;
+    static constexpr size_t max_zoom_levels = 10;
+    static constexpr uint32_t first_reduction = 32;
+    static constexpr uint32_t reduction_factor = 4;
+    static constexpr size_t items_per_slot = 1024;
+    static constexpr size_t block_size = 256;
+
+    explicit bigwig_sink(std::string const & path) :
+        file(path)
+    {
+        if (!zoom_blocks)
+        {
+            throw std::runtime_error("could not create a temporary file for the bigwig zoom levels.");
+        }
+        uint32_t reduction = first_reduction;
+        for (zoom_level & level : levels)
+        {
+            level.reduction = reduction;
+            reduction *= reduction_factor;
+        }
+        // the header, the zoom headers and the total summary are written at the end
+        file.write(std::string(data_count_offset + 8, '\0'));
+    }
+
+    void begin_record(std::string const & name) override
+    {
+        if (!names.insert(name).second)
+        {
+            throw std::runtime_error("the record name " + name + " occurs twice, bigwig needs unique names.");
+        }
+        chroms.push_back(chrom_entry{name, 0});
+        chrom_id = uint32_t(chroms.size() - 1);
+        position = 0;
+        run_start = 0;
+    }
+
+    void begin_region(std::string const &, size_t, size_t) override
+    {
+        throw std::invalid_argument("bigwig output needs whole records, it can not be used with --regions.");
+    }
+
+    void write(float const * scores, size_t n) override
+    {
+        if (position + n > std::numeric_limits<uint32_t>::max())
+        {
+            throw std::runtime_error("the record " + chroms.back().name + " is too long for bigwig.");
+        }
+        for (size_t i = 0; i < n; i++)
+        {
+            if (position > run_start && scores[i] != run_value)
+            {
+                add_run(run_start, position, run_value);
+                run_start = position;
+            }
+            run_value = scores[i];
+            position++;
+        }
+    }
+
+    void end_record() override
+    {
+        if (position > run_start)
+        {
+            add_run(run_start, position, run_value);
+        }
+        chroms.back().size = uint32_t(position);
+        write_section();
+        for (size_t i = 0; i < max_zoom_levels; i++)
+        {
+            close_bin(i);
+            write_zoom_block(levels[i]);
+        }
+    }
+
+    void finish() override
+    {
+        size_t index_offset = file.position();
+        write_rtree(data_index, index_offset);
+        // keep the zoom levels that reduce the number of records
+        size_t n_levels(0);
+        while (n_levels < max_zoom_levels && levels[n_levels].n_records > 0
+               && (n_levels == 0 || levels[n_levels].n_records < levels[n_levels - 1].n_records))
+        {
+            n_levels++;
+        }
+        std::vector<size_t> zoom_data_offsets;
+        std::vector<size_t> zoom_index_offsets;
+        std::string block;
+        for (size_t i = 0; i < n_levels; i++)
+        {
+            // the data offset of a level points at its record count
+            zoom_data_offsets.push_back(file.position());
+            std::string count;
+            put_le(count, uint32_t(levels[i].n_records));
+            file.write(count);
+            for (block_entry & entry : levels[i].index)
+            {
+                block.resize(entry.size);
+                if (std::fseek(zoom_blocks.get(), long(entry.offset), SEEK_SET) != 0
+                    || std::fread(block.data(), 1, entry.size, zoom_blocks.get()) != entry.size)
+                {
+                    throw std::runtime_error("could not read the bigwig zoom levels back from the temporary file.");
+                }
+                entry.offset = file.position();
+                file.write(block);
+            }
+            zoom_index_offsets.push_back(file.position());
+            write_rtree(levels[i].index, file.position());
+        }
+        size_t chrom_tree_offset = file.position();
+        write_chrom_tree(chrom_tree_offset);
+        file.flush();
+
+        std::string header;
+        put_le(header, magic);
+        put_le(header, version);
+        put_le(header, uint16_t(n_levels));
+        put_le(header, uint64_t(chrom_tree_offset));
+        put_le(header, uint64_t(data_count_offset));
+        put_le(header, uint64_t(index_offset));
+        // field count, defined field count and autoSql offset
+        put_le(header, uint16_t(0));
+        put_le(header, uint16_t(0));
+        put_le(header, uint64_t(0));
+        put_le(header, uint64_t(total_summary_offset));
+        put_le(header, uint32_t(max_uncompressed));
+        // extension offset
+        put_le(header, uint64_t(0));
+        for (size_t i = 0; i < n_levels; i++)
+        {
+            put_le(header, levels[i].reduction);
+            put_le(header, uint32_t(0));
+            put_le(header, uint64_t(zoom_data_offsets[i]));
+            put_le(header, uint64_t(zoom_index_offsets[i]));
+        }
+        header.resize(total_summary_offset, '\0');
+        put_le(header, uint64_t(total.count));
+        put_le(header, std::bit_cast<uint64_t>(total.count ? total.min : 0.0));
+        put_le(header, std::bit_cast<uint64_t>(total.count ? total.max : 0.0));
+        put_le(header, std::bit_cast<uint64_t>(total.sum));
+        put_le(header, std::bit_cast<uint64_t>(total.sum_squares));
+        put_le(header, uint64_t(n_sections));
+        file.write_at(0, header.data(), header.size());
+    }
+
+private:
+    static constexpr size_t header_size = 64;
+    static constexpr size_t total_summary_offset = header_size + 24 * max_zoom_levels;
+    static constexpr size_t data_count_offset = total_summary_offset + 40;
+
+    struct chrom_entry
+    {
+        std::string name;
+        uint32_t size;
+    };
+
+    // a leaf of an R-tree, the position of one compressed block
+    struct block_entry
+    {
+        uint32_t chrom_id;
+        uint32_t start;
+        uint32_t end;
+        size_t offset;
+        size_t size;
+    };
+
+    struct summary
+    {
+        uint32_t start{0};
+        uint32_t end{0};
+        uint64_t count{0};
+        double min{0.0};
+        double max{0.0};
+        double sum{0.0};
+        double sum_squares{0.0};
+
+        void add(summary const & other)
+        {
+            min = count ? std::min(min, other.min) : other.min;
+            max = count ? std::max(max, other.max) : other.max;
+            start = count ? start : other.start;
+            end = other.end;
+            count += other.count;
+            sum += other.sum;
+            sum_squares += other.sum_squares;
+        }
+    };
+
+    struct zoom_level
+    {
+        uint32_t reduction{0};
+        // the bin that is filled, bin_open tells if there is one
+        summary bin{};
+        bool bin_open{false};
+        // the records of the block that is filled
+        std::string block{};
+        size_t block_records{0};
+        uint32_t block_start{0};
+        size_t n_records{0};
+        std::vector<block_entry> index{};
+    };
+
+    output_file file;
+    std::unordered_set<std::string> names{};
+    std::vector<chrom_entry> chroms{};
+    uint32_t chrom_id{0};
+    size_t position{0};
+    // the run of equal scores that is extended
+    size_t run_start{0};
+    float run_value{0.0f};
+    // the runs of the data section that is filled
+    std::string section{};
+    size_t section_items{0};
+    uint32_t section_start{0};
+    uint32_t section_end{0};
+    size_t n_sections{0};
+    std::vector<block_entry> data_index{};
+    zoom_level levels[max_zoom_levels]{};
+    // the compressed zoom blocks of all levels until finish
+    std::unique_ptr<std::FILE, int (*)(std::FILE *)> zoom_blocks{std::tmpfile(), &std::fclose};
+    size_t zoom_blocks_size{0};
+    summary total{};
+    size_t max_uncompressed{0};
+
+    void add_run(size_t start, size_t end, float value)
+    {
+        if (section_items == 0)
+        {
+            section_start = uint32_t(start);
+        }
+        put_le(section, uint32_t(start));
+        put_le(section, uint32_t(end));
+        put_le(section, std::bit_cast<uint32_t>(value));
+        section_end = uint32_t(end);
+        if (++section_items == items_per_slot)
+        {
+            write_section();
+        }
+        // the run is cut at the bins of the first zoom level, which are
+        // nested in the bins of all further levels
+        uint32_t reduction = levels[0].reduction;
+        while (start < end)
+        {
+            size_t piece_end = std::min(end, (start / reduction + 1) * reduction);
+            double n = double(piece_end - start);
+            summary piece{uint32_t(start), uint32_t(piece_end), piece_end - start, value, value, n * value, n * value * value};
+            total.add(piece);
+            add_summary(0, piece);
+            start = piece_end;
+        }
+    }
+
+    // adds a summary that lies within one bin of the level
+    void add_summary(size_t i, summary const & s)
+    {
+        zoom_level & level = levels[i];
+        if (level.bin_open && s.start / level.reduction != level.bin.start / level.reduction)
+        {
+            close_bin(i);
+        }
+        if (!level.bin_open)
+        {
+            level.bin = summary{};
+            level.bin_open = true;
+        }
+        level.bin.add(s);
+    }
+
+    // writes the bin as zoom record and passes it on to the next level
+    void close_bin(size_t i)
+    {
+        zoom_level & level = levels[i];
+        if (!level.bin_open)
+        {
+            return;
+        }
+        level.bin_open = false;
+        summary const & bin = level.bin;
+        if (level.block_records == 0)
+        {
+            level.block_start = bin.start;
+        }
+        put_le(level.block, chrom_id);
+        put_le(level.block, bin.start);
+        put_le(level.block, bin.end);
+        put_le(level.block, uint32_t(bin.count));
+        put_le(level.block, std::bit_cast<uint32_t>(float(bin.min)));
+        put_le(level.block, std::bit_cast<uint32_t>(float(bin.max)));
+        put_le(level.block, std::bit_cast<uint32_t>(float(bin.sum)));
+        put_le(level.block, std::bit_cast<uint32_t>(float(bin.sum_squares)));
+        level.n_records++;
+        if (++level.block_records == items_per_slot)
+        {
+            write_zoom_block(level);
+        }
+        if (i + 1 < max_zoom_levels)
+        {
+            add_summary(i + 1, bin);
+        }
+    }
+
+    void write_section()
+    {
+        if (section_items == 0)
+        {
+            return;
+        }
+        std::string data;
+        put_le(data, chrom_id);
+        put_le(data, section_start);
+        put_le(data, section_end);
+        // item step and item span are unused by bedGraph sections
+        put_le(data, uint32_t(0));
+        put_le(data, uint32_t(0));
+        // type 1 is bedGraph
+        data.push_back(char(1));
+        data.push_back('\0');
+        put_le(data, uint16_t(section_items));
+        data += section;
+        data_index.push_back(write_block(data, section_start, section_end));
+        n_sections++;
+        section.clear();
+        section_items = 0;
+    }
+
+    void write_zoom_block(zoom_level & level)
+    {
+        if (level.block_records == 0)
+        {
+            return;
+        }
+        // the end of the last record
+        uint32_t end = get_le<uint32_t>(level.block.data() + level.block.size() - 24);
+        std::string compressed = compress_block(level.block);
+        level.index.push_back(block_entry{chrom_id, level.block_start, end, zoom_blocks_size, compressed.size()});
+        if (std::fwrite(compressed.data(), 1, compressed.size(), zoom_blocks.get()) != compressed.size())
+        {
+            throw std::runtime_error("could not write the bigwig zoom levels to a temporary file.");
+        }
+        zoom_blocks_size += compressed.size();
+        level.block.clear();
+        level.block_records = 0;
+    }
+
+    // compresses a block with zlib
+    std::string compress_block(std::string const & data)
+    {
+        uLongf size = compressBound(uLong(data.size()));
+        std::string compressed(size, '\0');
+        if (compress2(reinterpret_cast<Bytef *>(compressed.data()), &size,
+                      reinterpret_cast<Bytef const *>(data.data()), uLong(data.size()), Z_DEFAULT_COMPRESSION) != Z_OK)
+        {
+            throw std::runtime_error("could not compress a bigwig block.");
+        }
+        compressed.resize(size);
+        max_uncompressed = std::max(max_uncompressed, data.size());
+        return compressed;
+    }
+
+    // compresses a block with zlib and appends it to the file
+    block_entry write_block(std::string const & data, uint32_t start, uint32_t end)
+    {
+        std::string compressed = compress_block(data);
+        block_entry entry{chrom_id, start, end, file.position(), compressed.size()};
+        file.write(compressed);
+        return entry;
+    }
+
+    void write_rtree(std::vector<block_entry> const & blocks, size_t offset)
+    {
+        std::string tree;
+        put_le(tree, uint32_t(0x2468ACE0));
+        put_le(tree, uint32_t(block_size));
+        put_le(tree, uint64_t(blocks.size()));
+        put_le(tree, blocks.empty() ? uint32_t(0) : blocks.front().chrom_id);
+        put_le(tree, blocks.empty() ? uint32_t(0) : blocks.front().start);
+        put_le(tree, blocks.empty() ? uint32_t(0) : blocks.back().chrom_id);
+        put_le(tree, blocks.empty() ? uint32_t(0) : blocks.back().end);
+        // end of the indexed data
+        put_le(tree, uint64_t(offset));
+        put_le(tree, uint32_t(items_per_slot));
+        put_le(tree, uint32_t(0));
+        auto put_bounds = [&](block_entry const & first, block_entry const & last)
+        {
+            put_le(tree, first.chrom_id);
+            put_le(tree, first.start);
+            put_le(tree, last.chrom_id);
+            put_le(tree, last.end);
+        };
+        write_tree_nodes(tree, offset + tree.size(), blocks.size(), block_size, 32, 24,
+            [&](size_t i)
+            {
+                put_bounds(blocks[i], blocks[i]);
+                put_le(tree, uint64_t(blocks[i].offset));
+                put_le(tree, uint64_t(blocks[i].size));
+            },
+            [&](size_t first, size_t last, size_t child_offset)
+            {
+                put_bounds(blocks[first], blocks[last]);
+                put_le(tree, uint64_t(child_offset));
+            });
+        file.write(tree);
+    }
+
+    void write_chrom_tree(size_t offset)
+    {
+        std::vector<uint32_t> sorted(chroms.size());
+        for (uint32_t i = 0; i < sorted.size(); i++)
+        {
+            sorted[i] = i;
+        }
+        std::sort(sorted.begin(), sorted.end(), [&](uint32_t a, uint32_t b) { return chroms[a].name < chroms[b].name; });
+        size_t key_size(1);
+        for (chrom_entry const & chrom : chroms)
+        {
+            key_size = std::max(key_size, chrom.name.size());
+        }
+        size_t tree_block_size = std::clamp(chroms.size(), size_t(1), block_size);
+        std::string tree;
+        put_le(tree, uint32_t(0x78CA8C91));
+        put_le(tree, uint32_t(tree_block_size));
+        put_le(tree, uint32_t(key_size));
+        put_le(tree, uint32_t(8));
+        put_le(tree, uint64_t(chroms.size()));
+        put_le(tree, uint64_t(0));
+        auto put_key = [&](uint32_t id)
+        {
+            tree += chroms[id].name;
+            tree.append(key_size - chroms[id].name.size(), '\0');
+        };
+        write_tree_nodes(tree, offset + tree.size(), chroms.size(), tree_block_size, key_size + 8, key_size + 8,
+            [&](size_t i)
+            {
+                put_key(sorted[i]);
+                put_le(tree, sorted[i]);
+                put_le(tree, chroms[sorted[i]].size);
+            },
+            [&](size_t first, size_t, size_t child_offset)
+            {
+                put_key(sorted[first]);
+                put_le(tree, uint64_t(child_offset));
+            });
+        file.write(tree);
+    }
+};
+
+} // namespace seqomplexity
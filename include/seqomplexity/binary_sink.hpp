@@ -0,0 +1,96 @@
+#pragma once
+
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include <seqomplexity/output_file.hpp>
+#include <seqomplexity/score_sink.hpp>
+#include <seqomplexity/track_format.hpp>
+
+namespace seqomplexity
+{
+
+// binary track file that numpy or arrow can map without parsing.
+// it starts with a track_header of magic "SQXTRACK", version 1 and value
+// type 0 = float32, followed by the k values.
+// the values start at the next multiple of 64. every record is one
+// contiguous float32 array with one value per base. the record table at the
+// end holds for every record the offset of its first value (8 bytes), the
+// number of values (8 bytes), the name length (4 bytes) and the name, e.g.
+//     numpy.memmap(path, dtype='<f4', mode='r', offset=offset, shape=(length,))
+class binary_sink : public score_sink
+{
+public:
+    static constexpr char magic[9] = "SQXTRACK";
+    static constexpr uint32_t version = 1;
+    static constexpr uint32_t float32_values = 0;
+
+    binary_sink(std::string const & path, size_t wsize, std::vector<uint8_t> const & kmers) :
+        file(path)
+    {
+        std::string header = track_header::write(magic, version, float32_values, wsize, kmers.size());
+        track_header::append_kmers(header, kmers);
+        file.write(header);
+    }
+
+    void begin_record(std::string const & name) override
+    {
+        records.push_back(record_entry{name, file.position(), 0});
+    }
+
+    void write(float const * scores, size_t n) override
+    {
+        if constexpr (std::endian::native == std::endian::little)
+        {
+            file.write(scores, n * sizeof(float));
+        }
+        else
+        {
+            std::string bytes;
+            bytes.reserve(n * sizeof(float));
+            for (size_t i = 0; i < n; i++)
+            {
+                put_le(bytes, std::bit_cast<uint32_t>(scores[i]));
+            }
+            file.write(bytes);
+        }
+    }
+
+    void end_record() override
+    {
+        records.back().length = (file.position() - records.back().offset) / sizeof(float);
+    }
+
+    void finish() override
+    {
+        uint64_t table_offset = file.position();
+        std::string table;
+        for (record_entry const & record : records)
+        {
+            put_le(table, uint64_t(record.offset));
+            put_le(table, uint64_t(record.length));
+            put_le(table, uint32_t(record.name.size()));
+            table += record.name;
+        }
+        file.write(table);
+        file.flush();
+        track_header::write_counts(file, records.size(), table_offset);
+    }
+
+private:
+    struct record_entry
+    {
+        std::string name;
+        size_t offset;
+        size_t length;
+    };
+
+    output_file file;
+    std::vector<record_entry> records{};
+};
+
+} // namespace seqomplexity
@@ -0,0 +1,245 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include <seqomplexity/rolling_kmer.hpp>
+#include <seqomplexity/sliding_gc.hpp>
+
+namespace seqomplexity
+{
+
+// the metrics of the base composition of a window of w bases, from the counts
+// of A, C, G, T and of the CpG dinucleotides within the window:
+//     gc       (C + G) / w
+//     gc_skew  (G - C) / (G + C), 0 without G and C
+//     at_skew  (A - T) / (A + T), 0 without A and T
+//     cpg_oe   CpG * w / (C * G), the observed over the expected CpG, 0
+//              without C or G
+enum class composition_metric
+{
+    gc,
+    gc_skew,
+    at_skew,
+    cpg_oe
+};
+
+inline std::vector<std::string> const & composition_metric_names()
+{
+    static std::vector<std::string> const names{"gc", "gc_skew", "at_skew", "cpg_oe"};
+    return names;
+}
+
+inline composition_metric parse_composition_metric(std::string const & name)
+{
+    std::vector<std::string> const & names = composition_metric_names();
+    auto it = std::find(names.begin(), names.end(), name);
+    if (it == names.end())
+    {
+        throw std::invalid_argument("unknown metric " + name + ".");
+    }
+    return composition_metric(it - names.begin());
+}
+
+// several composition metrics of a sliding window in one pass. every base
+// updates the running counts once, which are kept for a block of bases in
+// flat arrays. every metric is then one pass over the arrays without
+// dependencies between bases, which the compiler vectorises, so every metric
+// costs a few instructions per base. the scores of every metric have the
+// layout of window_engine.
+class composition_engine
+{
+public:
+    static constexpr size_t block_size = 2048;
+
+    composition_engine(size_t wsize, std::vector<composition_metric> metrics) :
+        wsize(wsize),
+        metrics(std::move(metrics))
+    {
+        std::string error = sliding_gc::check_parameters(wsize);
+        if (!error.empty())
+        {
+            throw std::invalid_argument(error);
+        }
+        if (this->metrics.empty())
+        {
+            throw std::invalid_argument("At least one metric is required.");
+        }
+        codes.resize(wsize);
+        last_scores.resize(this->metrics.size());
+    }
+
+    size_t n_metrics() const
+    {
+        return metrics.size();
+    }
+
+    size_t window_size() const
+    {
+        return wsize;
+    }
+
+    // the most scores push can write per metric for n_bases bases
+    size_t max_scores(size_t n_bases) const
+    {
+        return n_bases + wsize/2;
+    }
+
+    // the most scores finish can write per metric
+    size_t max_finish_scores() const
+    {
+        return wsize - 1;
+    }
+
+    // appends bases of the current record and writes the scores of metric j
+    // that are complete to out[j], which must hold max_scores(n) floats.
+    // n_written[j] receives their number.
+    void push(std::span<char const> bases, std::span<float * const> out, std::span<size_t> n_written)
+    {
+        std::fill(n_written.begin(), n_written.end(), 0);
+        char const * seq = bases.data();
+        size_t n = bases.size();
+        while (n > 0)
+        {
+            size_t m = std::min(n, block_size);
+            // the first base of the block that completes a window
+            size_t first = n_bases + 1 >= wsize ? 0 : std::min(m, wsize - n_bases - 1);
+            for (size_t i = 0; i < m; i++)
+            {
+                uint8_t rank = dna5_rank(seq[i]);
+                uint8_t cpg = previous_rank == 1 && rank == 2;
+                previous_rank = rank;
+                bool sliding = n_bases + i >= wsize;
+                if (sliding)
+                {
+                    counts[codes[pos] & 7]--;
+                }
+                counts[rank]++;
+                codes[pos] = uint8_t(rank | cpg << 3);
+                n_cpg += cpg;
+                if (++pos == wsize)
+                {
+                    pos = 0;
+                }
+                if (sliding)
+                {
+                    // the pair of the leaving base and the base after it
+                    // left the window, the flag of a pair sits on its G
+                    n_cpg -= codes[pos] >> 3;
+                }
+                if (i >= first)
+                {
+                    n_a[i] = counts[0];
+                    n_c[i] = counts[1];
+                    n_g[i] = counts[2];
+                    n_t[i] = counts[3];
+                    n_cg[i] = n_cpg;
+                }
+            }
+            if (first < m)
+            {
+                for (size_t j = 0; j < metrics.size(); j++)
+                {
+                    float * o = out[j] + n_written[j];
+                    score_metric(metrics[j], first, m, scores);
+                    if (n_bases + 1 + first == wsize)
+                    {
+                        // padding to fill the first half of the window
+                        o = std::fill_n(o, wsize/2, scores[first]);
+                    }
+                    o = std::copy(scores + first, scores + m, o);
+                    last_scores[j] = scores[m - 1];
+                    n_written[j] = size_t(o - out[j]);
+                }
+            }
+            n_bases += m;
+            seq += m;
+            n -= m;
+        }
+    }
+
+    // ends the current record and writes the remaining scores of metric j to
+    // out[j], which must hold max_finish_scores() floats
+    void finish(std::span<float * const> out, std::span<size_t> n_written)
+    {
+        for (size_t j = 0; j < metrics.size(); j++)
+        {
+            n_written[j] = n_bases < wsize ? n_bases : (wsize-1)/2;
+            std::fill_n(out[j], n_written[j], n_bases < wsize ? 0.0f : last_scores[j]);
+        }
+        reset();
+    }
+
+    // drops the current record
+    void reset()
+    {
+        n_bases = 0;
+        pos = 0;
+        std::fill(counts, counts + 5, 0);
+        n_cpg = 0;
+        previous_rank = dna5_n_rank;
+    }
+
+private:
+    size_t wsize;
+    std::vector<composition_metric> metrics;
+    size_t n_bases{0};
+    // the rank of the last wsize bases and a flag on every G after a C
+    std::vector<uint8_t> codes{};
+    size_t pos{0};
+    int32_t counts[5]{};
+    int32_t n_cpg{0};
+    uint8_t previous_rank{dna5_n_rank};
+    std::vector<float> last_scores{};
+    // the counts after every base of the current block
+    int32_t n_a[block_size];
+    int32_t n_c[block_size];
+    int32_t n_g[block_size];
+    int32_t n_t[block_size];
+    int32_t n_cg[block_size];
+    float scores[block_size];
+
+    static float ratio(float numerator, float denominator)
+    {
+        return denominator > 0.0f ? numerator / denominator : 0.0f;
+    }
+
+    void score_metric(composition_metric metric, size_t begin, size_t end, float * out) const
+    {
+        float const w = float(wsize);
+        switch (metric)
+        {
+            case composition_metric::gc:
+                for (size_t i = begin; i < end; i++)
+                {
+                    out[i] = float(n_c[i] + n_g[i]) / w;
+                }
+                break;
+            case composition_metric::gc_skew:
+                for (size_t i = begin; i < end; i++)
+                {
+                    out[i] = ratio(float(n_g[i] - n_c[i]), float(n_g[i] + n_c[i]));
+                }
+                break;
+            case composition_metric::at_skew:
+                for (size_t i = begin; i < end; i++)
+                {
+                    out[i] = ratio(float(n_a[i] - n_t[i]), float(n_a[i] + n_t[i]));
+                }
+                break;
+            case composition_metric::cpg_oe:
+                for (size_t i = begin; i < end; i++)
+                {
+                    out[i] = ratio(float(n_cg[i]) * w, float(n_c[i]) * float(n_g[i]));
+                }
+                break;
+        }
+    }
+};
+
+} // namespace seqomplexity
@@ -0,0 +1,160 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <stdexcept>
+#include <vector>
+
+#include <seqomplexity/rolling_kmer.hpp>
+#include <seqomplexity/sliding_complexity.hpp>
+#include <seqomplexity/sliding_gc.hpp>
+
+namespace seqomplexity
+{
+
+// streams the bases of one record after the other through a sliding window
+// kernel and writes one score per base into spans given by the caller, with
+// the same layout as the tools: a record of n >= w bases gets w/2 copies of
+// the score of its first window, one score per window and (w-1)/2 copies of
+// the score of its last window. a record shorter than the window gets n zeros.
+// the engine does not allocate after its construction.
+template <typename kernel_t>
+class window_engine
+{
+public:
+    explicit window_engine(kernel_t kernel) :
+        kernel(std::move(kernel))
+    {}
+
+    size_t window_size() const
+    {
+        return kernel.window_size();
+    }
+
+    // the most scores push can write for n_bases bases
+    size_t max_scores(size_t n_bases) const
+    {
+        return n_bases + window_size()/2;
+    }
+
+    // the most scores finish can write
+    size_t max_finish_scores() const
+    {
+        return window_size() - 1;
+    }
+
+    // appends bases of the current record, given as characters, and writes
+    // the scores that are complete into out. returns the number of scores.
+    size_t push(std::span<char const> bases, std::span<float> out)
+    {
+        check_space(max_scores(bases.size()), out.size());
+        float * pos = out.data();
+        size_t i(0);
+        if constexpr (requires { kernel.score_bases(bases.data(), bases.size(), pos); })
+        {
+            // kernels that score blocks of bases take over once the window is full
+            for (; i < bases.size() && n_bases < window_size(); i++)
+            {
+                pos = push_rank(dna5_rank(bases[i]), pos);
+            }
+            kernel.score_bases(bases.data() + i, bases.size() - i, pos);
+            n_bases += bases.size() - i;
+            return size_t(pos - out.data()) + bases.size() - i;
+        }
+        for (; i < bases.size(); i++)
+        {
+            pos = push_rank(dna5_rank(bases[i]), pos);
+        }
+        return size_t(pos - out.data());
+    }
+
+    // same as push, for bases given as dna5 ranks A=0, C=1, G=2, T=3, N=4
+    size_t push_ranks(std::span<uint8_t const> ranks, std::span<float> out)
+    {
+        check_space(max_scores(ranks.size()), out.size());
+        float * pos = out.data();
+        for (uint8_t rank : ranks)
+        {
+            pos = push_rank(rank, pos);
+        }
+        return size_t(pos - out.data());
+    }
+
+    // ends the current record, writes its remaining scores into out and
+    // returns their number. the next push starts a new record.
+    size_t finish(std::span<float> out)
+    {
+        size_t wsize = window_size();
+        size_t n = n_bases < wsize ? n_bases : (wsize-1)/2;
+        check_space(n, out.size());
+        std::fill_n(out.data(), n, n_bases < wsize ? 0.0f : kernel.score());
+        reset();
+        return n;
+    }
+
+    // drops the current record
+    void reset()
+    {
+        kernel.reset();
+        n_bases = 0;
+    }
+
+    // number of bases pushed for the current record
+    size_t size() const
+    {
+        return n_bases;
+    }
+
+private:
+    kernel_t kernel;
+    size_t n_bases{0};
+
+    static void check_space(size_t needed, size_t available)
+    {
+        if (available < needed)
+        {
+            throw std::length_error("the output span is too small for the scores.");
+        }
+    }
+
+    float * push_rank(uint8_t rank, float * out)
+    {
+        n_bases++;
+        if (!kernel.push(rank))
+        {
+            return out;
+        }
+        float score = kernel.score();
+        // padding to fill the first half of the window
+        if (n_bases == kernel.window_size())
+        {
+            out = std::fill_n(out, kernel.window_size()/2, score);
+        }
+        *out++ = score;
+        return out;
+    }
+};
+
+// the sequence complexity of every base, see sliding_complexity.
+// throws std::invalid_argument if w and k can not be used.
+class complexity_engine : public window_engine<sliding_complexity>
+{
+public:
+    complexity_engine(size_t wsize, std::vector<uint8_t> const & kmers) :
+        window_engine<sliding_complexity>(sliding_complexity(wsize, kmers))
+    {}
+};
+
+// the GC content of every base, see sliding_gc.
+// throws std::invalid_argument if w can not be used.
+class gc_engine : public window_engine<sliding_gc>
+{
+public:
+    explicit gc_engine(size_t wsize) :
+        window_engine<sliding_gc>(sliding_gc(wsize))
+    {}
+};
+
+} // namespace seqomplexity
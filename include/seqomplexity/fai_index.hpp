@@ -0,0 +1,182 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include <seqomplexity/mapped_file.hpp>
+
+namespace seqomplexity
+{
+
+// one line of a samtools compatible .fai index
+struct fai_record
+{
+    std::string name{};
+    size_t length{0};
+    size_t offset{0};
+    size_t line_bases{0};
+    size_t line_width{0};
+};
+
+// random access to the records of a FASTA file with fixed line lengths
+class fai_index
+{
+public:
+    std::vector<fai_record> records{};
+
+    // reads fasta_path.fai if it exists. otherwise the index is built from the
+    // mapped FASTA and saved next to it, if that location is writable.
+    static fai_index load_or_build(std::string const & fasta_path, mapped_file const & fasta)
+    {
+        std::ifstream in(fasta_path + ".fai");
+        if (in)
+        {
+            return read(in);
+        }
+        // building reads the whole FASTA front to back once
+        fasta.advise_sequential();
+        fai_index index = build(fasta.data(), fasta.size());
+        std::ofstream out(fasta_path + ".fai");
+        if (out)
+        {
+            index.write(out);
+        }
+        return index;
+    }
+
+    static fai_index read(std::istream & in)
+    {
+        fai_index index;
+        std::string line;
+        while (std::getline(in, line))
+        {
+            if (line.empty())
+            {
+                continue;
+            }
+            std::istringstream fields(line);
+            fai_record record;
+            if (!std::getline(fields, record.name, '\t')
+                || !(fields >> record.length >> record.offset >> record.line_bases >> record.line_width))
+            {
+                throw std::runtime_error("malformed .fai line: " + line);
+            }
+            index.add(std::move(record));
+        }
+        return index;
+    }
+
+    // scans the FASTA like samtools faidx. all lines of a record except the
+    // last one must have the same length.
+    static fai_index build(char const * data, size_t size)
+    {
+        fai_index index;
+        fai_record * record = nullptr;
+        // a record may only end with a shorter line or empty lines
+        bool short_line_seen(false);
+        size_t pos(0);
+        while (pos < size)
+        {
+            char const * newline = static_cast<char const *>(std::memchr(data + pos, '\n', size - pos));
+            size_t line_end = newline ? size_t(newline - data) : size;
+            size_t next = newline ? line_end + 1 : size;
+            size_t content_end = line_end;
+            if (content_end > pos && data[content_end - 1] == '\r')
+            {
+                content_end--;
+            }
+            size_t n_bases = content_end - pos;
+            if (data[pos] == '>')
+            {
+                std::string header(data + pos + 1, content_end - pos - 1);
+                index.records.push_back(fai_record{header.substr(0, header.find_first_of(" \t")), 0, next, 0, 0});
+                record = &index.records.back();
+                short_line_seen = false;
+            }
+            else if (n_bases == 0)
+            {
+                short_line_seen = true;
+            }
+            else if (record == nullptr)
+            {
+                throw std::runtime_error("the FASTA file does not start with a header.");
+            }
+            else
+            {
+                size_t width = next - pos;
+                if (record->line_bases == 0)
+                {
+                    record->line_bases = n_bases;
+                    record->line_width = width;
+                }
+                else if (short_line_seen || n_bases > record->line_bases
+                         || (newline && width - n_bases != record->line_width - record->line_bases))
+                {
+                    throw std::runtime_error("different line lengths in record " + record->name + ", can not index it.");
+                }
+                short_line_seen = n_bases < record->line_bases;
+                record->length += n_bases;
+            }
+            pos = next;
+        }
+        for (size_t i = 0; i < index.records.size(); i++)
+        {
+            index.by_name[index.records[i].name] = i;
+        }
+        return index;
+    }
+
+    void write(std::ostream & out) const
+    {
+        for (fai_record const & record : records)
+        {
+            out << record.name << '\t' << record.length << '\t' << record.offset << '\t'
+                << record.line_bases << '\t' << record.line_width << '\n';
+        }
+    }
+
+    // returns nullptr for unknown names
+    fai_record const * find(std::string const & name) const
+    {
+        auto it = by_name.find(name);
+        return it == by_name.end() ? nullptr : &records[it->second];
+    }
+
+    // copies the bases [begin, end) of a record without the line breaks
+    static void fetch(char const * data, size_t size, fai_record const & record, size_t begin, size_t end, std::string & out)
+    {
+        out.clear();
+        out.reserve(end - begin);
+        size_t pos = begin;
+        while (pos < end)
+        {
+            size_t column = pos % record.line_bases;
+            size_t n = std::min(end - pos, record.line_bases - column);
+            size_t offset = record.offset + (pos / record.line_bases) * record.line_width + column;
+            if (offset + n > size)
+            {
+                throw std::runtime_error("the index of " + record.name + " does not match the FASTA file.");
+            }
+            out.append(data + offset, n);
+            pos += n;
+        }
+    }
+
+private:
+    std::unordered_map<std::string, size_t> by_name{};
+
+    void add(fai_record record)
+    {
+        by_name[record.name] = records.size();
+        records.push_back(std::move(record));
+    }
+};
+
+} // namespace seqomplexity
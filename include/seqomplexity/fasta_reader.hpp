@@ -0,0 +1,135 @@
+#pragma once
+
+#include <cstddef>
+#include <cstring>
+#include <memory>
+#include <string>
+
+#include <seqomplexity/input_source.hpp>
+
+namespace seqomplexity
+{
+
+// returns the name of a record, the header up to the first whitespace
+inline std::string record_name(std::string const & header)
+{
+    return header.substr(0, header.find_first_of(" \t"));
+}
+
+// scans FASTA from an input source block by block. the bases are handed to
+// the handler as spans into the block, one span per line or block piece, so
+// no line is copied or allocated. headers may span block boundaries.
+// the handler needs these members:
+//     void begin_record(std::string const & header); // header without '>'
+//     void bases(char const * seq, size_t n);
+//     void end_record();
+// bases before the first header form a record with an empty header.
+class fasta_reader
+{
+public:
+    explicit fasta_reader(input_source & source) :
+        source(source)
+    {}
+
+    // reads uncompressed FASTA from a file descriptor
+    explicit fasta_reader(int fd, size_t block_size = input_source::default_block_size) :
+        owned_source(std::make_unique<plain_source>(fd_stream(fd), block_size)),
+        source(*owned_source)
+    {}
+
+    template <typename handler_t>
+    void read(handler_t & handler)
+    {
+        enum class state { line_start, header, sequence };
+        state st = state::line_start;
+        bool in_record(false);
+        std::string header;
+        size_t n;
+        char const * data;
+        while ((n = source.next_block(data)) > 0)
+        {
+            char const * p = data;
+            char const * end = p + n;
+            while (p < end)
+            {
+                if (st == state::line_start)
+                {
+                    if (*p == '>')
+                    {
+                        if (in_record)
+                        {
+                            handler.end_record();
+                        }
+                        in_record = true;
+                        header.clear();
+                        st = state::header;
+                        p++;
+                        continue;
+                    }
+                    st = state::sequence;
+                }
+                char const * newline = static_cast<char const *>(std::memchr(p, '\n', end - p));
+                char const * stop = newline ? newline : end;
+                if (st == state::header)
+                {
+                    header.append(p, stop);
+                    if (newline)
+                    {
+                        finish_header(header);
+                        handler.begin_record(header);
+                    }
+                }
+                else
+                {
+                    // windows line endings
+                    if (stop > p && stop[-1] == '\r')
+                    {
+                        --stop;
+                    }
+                    if (stop > p)
+                    {
+                        if (!in_record)
+                        {
+                            handler.begin_record(header);
+                            in_record = true;
+                        }
+                        handler.bases(p, stop - p);
+                    }
+                }
+                if (newline)
+                {
+                    st = state::line_start;
+                    p = newline + 1;
+                }
+                else
+                {
+                    p = end;
+                }
+            }
+        }
+        // a header in the last line without a newline
+        if (st == state::header)
+        {
+            finish_header(header);
+            handler.begin_record(header);
+        }
+        if (in_record)
+        {
+            handler.end_record();
+        }
+    }
+
+private:
+    std::unique_ptr<input_source> owned_source{};
+    input_source & source;
+
+    static void finish_header(std::string & header)
+    {
+        if (!header.empty() && header.back() == '\r')
+        {
+            header.pop_back();
+        }
+    }
+};
+
+} // namespace seqomplexity
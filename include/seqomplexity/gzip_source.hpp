@@ -0,0 +1,358 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include <zlib.h>
+
+#include <seqomplexity/input_source.hpp>
+#include <seqomplexity/track_format.hpp>
+#include <seqomplexity/work_stealing_pool.hpp>
+
+namespace seqomplexity
+{
+
+// streaming decompression of gzip input, including several concatenated
+// gzip members as written by e.g. pigz or cat a.gz b.gz
+class gzip_source : public input_source
+{
+public:
+    static constexpr size_t input_buffer_size = size_t(1) << 20;
+
+    explicit gzip_source(fd_stream in, size_t block_size = default_block_size) :
+        in(std::move(in)),
+        input(input_buffer_size),
+        block(block_size)
+    {
+        // 15 + 32 detects the gzip header
+        if (inflateInit2(&stream, 15 + 32) != Z_OK)
+        {
+            throw std::runtime_error("could not initialise zlib.");
+        }
+    }
+
+    gzip_source(gzip_source const &) = delete;
+    gzip_source & operator=(gzip_source const &) = delete;
+
+    ~gzip_source()
+    {
+        inflateEnd(&stream);
+    }
+
+    size_t next_block(char const *& data) override
+    {
+        data = block.data();
+        stream.next_out = reinterpret_cast<Bytef *>(block.data());
+        stream.avail_out = uInt(block.size());
+        while (stream.avail_out > 0 && !at_end)
+        {
+            if (stream.avail_in == 0)
+            {
+                size_t n = in.read(input.data(), input.size());
+                if (n == 0)
+                {
+                    if (in_member)
+                    {
+                        throw std::runtime_error("the gzip input is truncated.");
+                    }
+                    at_end = true;
+                    break;
+                }
+                stream.next_in = reinterpret_cast<Bytef *>(input.data());
+                stream.avail_in = uInt(n);
+            }
+            in_member = true;
+            int status = inflate(&stream, Z_NO_FLUSH);
+            if (status == Z_STREAM_END)
+            {
+                // another member may follow
+                in_member = false;
+                inflateReset(&stream);
+            }
+            else if (status != Z_OK && status != Z_BUF_ERROR)
+            {
+                throw std::runtime_error(std::string("corrupt gzip input: ") + (stream.msg ? stream.msg : "unknown error"));
+            }
+        }
+        return block.size() - stream.avail_out;
+    }
+
+private:
+    fd_stream in;
+    std::vector<char> input;
+    std::vector<char> block;
+    z_stream stream{};
+    bool in_member{false};
+    bool at_end{false};
+};
+
+// parallel decompression of BGZF input, the blocked gzip of bgzip and htslib.
+// the compressed blocks are read in batches, the blocks of a batch are
+// inflated on a work stealing pool straight into one buffer at the offsets
+// given by their sizes. the next batch is decompressed while the current one
+// is scanned.
+class bgzf_source : public input_source
+{
+public:
+    static constexpr size_t blocks_per_batch = 512;
+    static constexpr size_t header_size = 18;
+
+    bgzf_source(fd_stream in, size_t n_threads) :
+        in(std::move(in)),
+        pool(std::max(n_threads, size_t(1))),
+        inflaters(pool.size())
+    {
+        submit(batches[0]);
+    }
+
+    // tells if the first n bytes of a gzip member are a BGZF block header: the
+    // extra field is 6 bytes long (XLEN, 16 bits) and holds just the BC
+    // subfield with the 2 byte block size
+    static bool is_block_header(unsigned char const * header, size_t n)
+    {
+        return n == header_size && header[0] == 0x1f && header[1] == 0x8b && (header[3] & 4) != 0
+            && get_le<uint16_t>(header + 10) == 6 && header[12] == 'B' && header[13] == 'C'
+            && get_le<uint16_t>(header + 14) == 2;
+    }
+
+    // waits for the tasks that still write into the batches
+    ~bgzf_source()
+    {
+        for (batch & b : batches)
+        {
+            wait(b);
+        }
+    }
+
+    size_t next_block(char const *& data) override
+    {
+        while (true)
+        {
+            batch & current = batches[current_batch];
+            wait(current);
+            if (!current.error.empty())
+            {
+                throw std::runtime_error(current.error);
+            }
+            // a batch without blocks marks the end of the input
+            if (current.block_offsets.size() <= 1)
+            {
+                return 0;
+            }
+            current_batch ^= 1;
+            // the other batch was handed out before and is free again
+            submit(batches[current_batch]);
+            // batches of empty blocks are skipped
+            if (!current.output.empty())
+            {
+                data = current.output.data();
+                return current.output.size();
+            }
+        }
+    }
+
+private:
+    struct batch
+    {
+        std::vector<char> compressed{};
+        // offset of the compressed and the decompressed data of every block
+        std::vector<size_t> block_offsets{};
+        std::vector<size_t> output_offsets{};
+        std::vector<char> output{};
+        size_t tasks_left{0};
+        std::string error{};
+    };
+
+    // one raw deflate stream per worker
+    struct inflater
+    {
+        z_stream stream{};
+        bool initialised{false};
+
+        ~inflater()
+        {
+            if (initialised)
+            {
+                inflateEnd(&stream);
+            }
+        }
+    };
+
+    fd_stream in;
+    bool at_end{false};
+    batch batches[2]{};
+    size_t current_batch{0};
+    std::mutex done_mutex{};
+    std::condition_variable done{};
+    work_stealing_pool pool;
+    std::vector<inflater> inflaters;
+
+    // appends the next BGZF block to the batch, false at the end of the input
+    bool read_compressed_block(batch & b)
+    {
+        size_t start = b.compressed.size();
+        b.compressed.resize(start + header_size);
+        size_t n = in.read_full(b.compressed.data() + start, header_size);
+        if (n == 0)
+        {
+            b.compressed.resize(start);
+            return false;
+        }
+        unsigned char const * header = reinterpret_cast<unsigned char const *>(b.compressed.data() + start);
+        if (!is_block_header(header, n))
+        {
+            throw std::runtime_error("the input is not valid BGZF.");
+        }
+        size_t block_size = size_t(get_le<uint16_t>(header + 16)) + 1;
+        if (block_size < header_size + 8)
+        {
+            throw std::runtime_error("the input is not valid BGZF.");
+        }
+        b.compressed.resize(start + block_size);
+        if (in.read_full(b.compressed.data() + start + header_size, block_size - header_size) != block_size - header_size)
+        {
+            throw std::runtime_error("the BGZF input is truncated.");
+        }
+        b.block_offsets.push_back(start);
+        return true;
+    }
+
+    // reads the next batch and starts its decompression
+    void submit(batch & b)
+    {
+        b.compressed.clear();
+        b.block_offsets.clear();
+        b.output_offsets.clear();
+        b.output.clear();
+        b.error.clear();
+        try
+        {
+            while (!at_end && b.block_offsets.size() < blocks_per_batch)
+            {
+                at_end = !read_compressed_block(b);
+            }
+        }
+        catch (std::exception const & e)
+        {
+            b.error = e.what();
+            at_end = true;
+            return;
+        }
+        size_t n_blocks = b.block_offsets.size();
+        b.block_offsets.push_back(b.compressed.size());
+        size_t output_size(0);
+        for (size_t i = 0; i < n_blocks; i++)
+        {
+            b.output_offsets.push_back(output_size);
+            output_size += get_le<uint32_t>(b.compressed.data() + b.block_offsets[i + 1] - 4);
+        }
+        b.output_offsets.push_back(output_size);
+        b.output.resize(output_size);
+        size_t n_tasks = std::min(n_blocks, pool.size());
+        if (n_tasks == 0)
+        {
+            return;
+        }
+        {
+            std::lock_guard<std::mutex> lock(done_mutex);
+            b.tasks_left = n_tasks;
+        }
+        for (size_t t = 0; t < n_tasks; t++)
+        {
+            pool.submit([this, &b, t, n_tasks, n_blocks](size_t worker)
+            {
+                std::string error;
+                try
+                {
+                    for (size_t i = t * n_blocks / n_tasks; i < (t + 1) * n_blocks / n_tasks; i++)
+                    {
+                        inflate_block(inflaters[worker], b, i);
+                    }
+                }
+                catch (std::exception const & e)
+                {
+                    error = e.what();
+                }
+                std::lock_guard<std::mutex> lock(done_mutex);
+                if (!error.empty())
+                {
+                    b.error = error;
+                }
+                if (--b.tasks_left == 0)
+                {
+                    done.notify_all();
+                }
+            });
+        }
+    }
+
+    void wait(batch & b)
+    {
+        std::unique_lock<std::mutex> lock(done_mutex);
+        done.wait(lock, [&]() { return b.tasks_left == 0; });
+    }
+
+    static void inflate_block(inflater & inf, batch & b, size_t i)
+    {
+        if (!inf.initialised)
+        {
+            if (inflateInit2(&inf.stream, -15) != Z_OK)
+            {
+                throw std::runtime_error("could not initialise zlib.");
+            }
+            inf.initialised = true;
+        }
+        else
+        {
+            inflateReset(&inf.stream);
+        }
+        unsigned char * block = reinterpret_cast<unsigned char *>(b.compressed.data() + b.block_offsets[i]);
+        size_t block_size = b.block_offsets[i + 1] - b.block_offsets[i];
+        size_t output_size = b.output_offsets[i + 1] - b.output_offsets[i];
+        unsigned char * output = reinterpret_cast<unsigned char *>(b.output.data() + b.output_offsets[i]);
+        inf.stream.next_in = block + header_size;
+        inf.stream.avail_in = uInt(block_size - header_size - 8);
+        inf.stream.next_out = output;
+        inf.stream.avail_out = uInt(output_size);
+        int status = inflate(&inf.stream, Z_FINISH);
+        if (status != Z_STREAM_END || inf.stream.avail_out != 0)
+        {
+            throw std::runtime_error("corrupt BGZF block in the input.");
+        }
+        if (crc32(crc32(0L, Z_NULL, 0), output, uInt(output_size)) != get_le<uint32_t>(block + block_size - 8))
+        {
+            throw std::runtime_error("CRC mismatch in a BGZF block of the input.");
+        }
+    }
+};
+
+// opens FASTA input that is plain, gzip or BGZF compressed, which is detected
+// from its first bytes. BGZF is decompressed on n_threads threads.
+inline std::unique_ptr<input_source> open_input(int fd, size_t n_threads = 1)
+{
+    fd_stream in(fd);
+    std::string magic(bgzf_source::header_size, '\0');
+    magic.resize(in.read_full(magic.data(), magic.size()));
+    unsigned char const * bytes = reinterpret_cast<unsigned char const *>(magic.data());
+    bool gzip = magic.size() >= 2 && bytes[0] == 0x1f && bytes[1] == 0x8b;
+    bool bgzf = bgzf_source::is_block_header(bytes, magic.size());
+    fd_stream rewound(fd, std::move(magic));
+    if (bgzf)
+    {
+        return std::make_unique<bgzf_source>(std::move(rewound), n_threads);
+    }
+    if (gzip)
+    {
+        return std::make_unique<gzip_source>(std::move(rewound));
+    }
+    return std::make_unique<plain_source>(std::move(rewound));
+}
+
+} // namespace seqomplexity
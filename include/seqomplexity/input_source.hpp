@@ -0,0 +1,105 @@
+#pragma once
+
+#include <algorithm>
+#include <cerrno>
+#include <cstddef>
+#include <cstring>
+#include <string>
+#include <system_error>
+#include <vector>
+
+#include <unistd.h>
+
+namespace seqomplexity
+{
+
+// a file descriptor with bytes in front of it that were already read, e.g. to
+// detect the compression of the input
+class fd_stream
+{
+public:
+    explicit fd_stream(int fd, std::string prefix = std::string()) :
+        fd(fd),
+        prefix(std::move(prefix))
+    {}
+
+    // reads up to n bytes, returns 0 only at the end of the input
+    size_t read(char * out, size_t n)
+    {
+        if (prefix_pos < prefix.size())
+        {
+            size_t m = std::min(n, prefix.size() - prefix_pos);
+            std::memcpy(out, prefix.data() + prefix_pos, m);
+            prefix_pos += m;
+            return m;
+        }
+        while (true)
+        {
+            ssize_t m = ::read(fd, out, n);
+            if (m >= 0)
+            {
+                return size_t(m);
+            }
+            if (errno != EINTR)
+            {
+                throw std::system_error(errno, std::generic_category(), "could not read the input");
+            }
+        }
+    }
+
+    // reads n bytes unless the input ends before
+    size_t read_full(char * out, size_t n)
+    {
+        size_t total(0);
+        while (total < n)
+        {
+            size_t m = read(out + total, n - total);
+            if (m == 0)
+            {
+                break;
+            }
+            total += m;
+        }
+        return total;
+    }
+
+private:
+    int fd;
+    std::string prefix;
+    size_t prefix_pos{0};
+};
+
+// the bytes of an input, handed out in blocks of any size
+class input_source
+{
+public:
+    static constexpr size_t default_block_size = size_t(1) << 22;
+
+    virtual ~input_source() = default;
+
+    // points data to the next block and returns its size, 0 at the end of the
+    // input. the block stays valid until the next call.
+    virtual size_t next_block(char const *& data) = 0;
+};
+
+// uncompressed input
+class plain_source : public input_source
+{
+public:
+    explicit plain_source(fd_stream in, size_t block_size = default_block_size) :
+        in(std::move(in)),
+        block(block_size)
+    {}
+
+    size_t next_block(char const *& data) override
+    {
+        data = block.data();
+        return in.read(block.data(), block.size());
+    }
+
+private:
+    fd_stream in;
+    std::vector<char> block;
+};
+
+} // namespace seqomplexity
@@ -0,0 +1,158 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include <seqomplexity/rolling_kmer.hpp>
+
+namespace seqomplexity
+{
+
+// counts the occurrences of every k-mer inside a sliding window and keeps the
+// number of distinct k-mers up to date. adding or removing a single k-mer is
+// O(1), so the cost per base no longer depends on the window size.
+// k-mers without N are counted in a directly indexed table while 4^k stays
+// below 2^max_direct_bits. everything else goes to an open addressing table
+// that is sized for the k-mers of one window and therefore never has to grow;
+// next to a direct table it is only allocated once a k-mer with N shows up.
+class kmer_counter
+{
+public:
+    static constexpr size_t max_direct_bits = 20;
+
+    kmer_counter(size_t k, size_t window_kmers)
+    {
+        if (2 * k <= max_direct_bits)
+        {
+            direct_counts.assign(size_t(1) << (2 * k), 0);
+        }
+        // keep the load factor at or below 1/2
+        size_t capacity(16);
+        while (capacity < 2 * window_kmers)
+        {
+            capacity <<= 1;
+        }
+        slot_mask = capacity - 1;
+        slot_shift = 64 - bit_width(capacity);
+        if (direct_counts.empty())
+        {
+            allocate_slots();
+        }
+    }
+
+    // returns true if the k-mer was not part of the window before
+    bool add(packed_kmer const & kmer)
+    {
+        bool first;
+        if (kmer.n_mask == 0 && !direct_counts.empty())
+        {
+            first = direct_counts[kmer.bases]++ == 0;
+        }
+        else
+        {
+            // with a direct table the slots only hold k-mers containing N
+            if (slot_counts.empty())
+            {
+                allocate_slots();
+            }
+            size_t slot = find_slot(kmer);
+            first = slot_counts[slot]++ == 0;
+            slot_kmers[slot] = kmer;
+        }
+        n_distinct += first;
+        return first;
+    }
+
+    // removes one occurrence of a k-mer that is part of the window.
+    // returns true if this was its last occurrence.
+    bool remove(packed_kmer const & kmer)
+    {
+        bool last;
+        if (kmer.n_mask == 0 && !direct_counts.empty())
+        {
+            last = --direct_counts[kmer.bases] == 0;
+        }
+        else
+        {
+            size_t slot = find_slot(kmer);
+            last = --slot_counts[slot] == 0;
+            if (last)
+            {
+                erase_slot(slot);
+            }
+        }
+        n_distinct -= last;
+        return last;
+    }
+
+    size_t distinct() const
+    {
+        return n_distinct;
+    }
+
+private:
+    std::vector<uint32_t> direct_counts{};
+    std::vector<packed_kmer> slot_kmers{};
+    std::vector<uint32_t> slot_counts{};
+    size_t slot_mask{0};
+    size_t slot_shift{0};
+    size_t n_distinct{0};
+
+    void allocate_slots()
+    {
+        slot_kmers.assign(slot_mask + 1, packed_kmer{});
+        slot_counts.assign(slot_mask + 1, 0);
+    }
+
+    static size_t bit_width(size_t x)
+    {
+        size_t width(0);
+        while (x > 1)
+        {
+            x >>= 1;
+            width++;
+        }
+        return width;
+    }
+
+    size_t home_slot(packed_kmer const & kmer) const
+    {
+        // fibonacci hashing spreads the packed k-mers over the table
+        uint64_t h = (kmer.bases ^ (kmer.n_mask * 0xC2B2AE3D27D4EB4Full)) * 0x9E3779B97F4A7C15ull;
+        return size_t(h >> slot_shift) & slot_mask;
+    }
+
+    // returns the slot holding the k-mer or the empty slot where it belongs
+    size_t find_slot(packed_kmer const & kmer) const
+    {
+        size_t slot = home_slot(kmer);
+        while (slot_counts[slot] != 0 && !(slot_kmers[slot] == kmer))
+        {
+            slot = (slot + 1) & slot_mask;
+        }
+        return slot;
+    }
+
+    // backward shift deletion keeps the probe sequences intact without tombstones
+    void erase_slot(size_t slot)
+    {
+        size_t next = (slot + 1) & slot_mask;
+        while (slot_counts[next] != 0)
+        {
+            size_t home = home_slot(slot_kmers[next]);
+            // move the entry back if its home slot is not in (slot, next]
+            if (((next - home) & slot_mask) >= ((next - slot) & slot_mask))
+            {
+                slot_kmers[slot] = slot_kmers[next];
+                slot_counts[slot] = slot_counts[next];
+                slot_counts[next] = 0;
+                slot = next;
+            }
+            next = (next + 1) & slot_mask;
+        }
+    }
+};
+
+} // namespace seqomplexity
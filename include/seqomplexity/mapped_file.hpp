@@ -0,0 +1,84 @@
+#pragma once
+
+#include <cerrno>
+#include <cstddef>
+#include <string>
+#include <system_error>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace seqomplexity
+{
+
+// a read only memory map of a whole file
+class mapped_file
+{
+public:
+    explicit mapped_file(std::string const & path)
+    {
+        int fd = ::open(path.c_str(), O_RDONLY);
+        if (fd < 0)
+        {
+            throw std::system_error(errno, std::generic_category(), "could not open " + path);
+        }
+        struct stat st;
+        if (::fstat(fd, &st) != 0)
+        {
+            int err = errno;
+            ::close(fd);
+            throw std::system_error(err, std::generic_category(), "could not stat " + path);
+        }
+        length = size_t(st.st_size);
+        if (length > 0)
+        {
+            void * map = ::mmap(nullptr, length, PROT_READ, MAP_PRIVATE, fd, 0);
+            if (map == MAP_FAILED)
+            {
+                int err = errno;
+                ::close(fd);
+                throw std::system_error(err, std::generic_category(), "could not map " + path);
+            }
+            bytes = static_cast<char const *>(map);
+        }
+        ::close(fd);
+    }
+
+    mapped_file(mapped_file const &) = delete;
+    mapped_file & operator=(mapped_file const &) = delete;
+
+    ~mapped_file()
+    {
+        if (bytes != nullptr)
+        {
+            ::munmap(const_cast<char *>(bytes), length);
+        }
+    }
+
+    char const * data() const
+    {
+        return bytes;
+    }
+
+    size_t size() const
+    {
+        return length;
+    }
+
+    // hints the kernel that the file will be read front to back
+    void advise_sequential() const
+    {
+        if (bytes != nullptr)
+        {
+            ::madvise(const_cast<char *>(bytes), length, MADV_SEQUENTIAL);
+        }
+    }
+
+private:
+    char const * bytes{nullptr};
+    size_t length{0};
+};
+
+} // namespace seqomplexity
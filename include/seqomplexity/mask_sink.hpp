@@ -0,0 +1,195 @@
+#pragma once
+
+#include <algorithm>
+#include <charconv>
+#include <cstddef>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <seqomplexity/output_file.hpp>
+#include <seqomplexity/score_sink.hpp>
+
+namespace seqomplexity
+{
+
+// turns the per base scores of a record into intervals of positions scoring
+// below a threshold. intervals closer than merge_gap positions are merged
+// and merged intervals shorter than min_length are dropped. every position
+// before decided() is final, masked or not.
+class interval_masker
+{
+public:
+    interval_masker(float threshold, size_t min_length, size_t merge_gap) :
+        threshold(threshold),
+        min_length(min_length),
+        merge_gap(merge_gap)
+    {}
+
+    void reset()
+    {
+        position = 0;
+        open = false;
+        intervals.clear();
+    }
+
+    void push(float const * scores, size_t n)
+    {
+        for (size_t i = 0; i < n; i++, position++)
+        {
+            if (scores[i] < threshold)
+            {
+                if (open && position - end <= merge_gap)
+                {
+                    end = position + 1;
+                    continue;
+                }
+                close();
+                open = true;
+                start = position;
+                end = position + 1;
+            }
+            else if (open && position + 1 - end > merge_gap)
+            {
+                // no later position can be merged into the interval
+                close();
+            }
+        }
+    }
+
+    // closes the interval at the end of the record
+    void finish()
+    {
+        close();
+    }
+
+    size_t decided() const
+    {
+        return open ? start : position;
+    }
+
+    // the intervals that were closed since the last call
+    std::vector<std::pair<size_t, size_t>> take_intervals()
+    {
+        return std::exchange(intervals, {});
+    }
+
+private:
+    float threshold;
+    size_t min_length;
+    size_t merge_gap;
+    size_t position{0};
+    bool open{false};
+    size_t start{0};
+    size_t end{0};
+    std::vector<std::pair<size_t, size_t>> intervals{};
+
+    void close()
+    {
+        if (open && end - start >= std::max(min_length, size_t(1)))
+        {
+            intervals.emplace_back(start, end);
+        }
+        open = false;
+    }
+};
+
+// writes the low scoring intervals of every record as BED lines instead of
+// the scores, so the output holds a few lines per masked region instead of
+// one value per base
+class mask_sink : public score_sink
+{
+public:
+    mask_sink(std::unique_ptr<byte_output> out, float threshold, size_t min_length, size_t merge_gap) :
+        out(std::move(out)),
+        masker(threshold, min_length, merge_gap)
+    {}
+
+    void begin_record(std::string const & name) override
+    {
+        chrom = name;
+        offset = 0;
+        masker.reset();
+    }
+
+    // the intervals of a region are given in the coordinates of its chrom
+    void begin_region(std::string const & region_chrom, size_t start, size_t) override
+    {
+        chrom = region_chrom;
+        offset = start;
+        masker.reset();
+    }
+
+    void write(float const * scores, size_t n) override
+    {
+        masker.push(scores, n);
+        write_intervals();
+    }
+
+    void end_record() override
+    {
+        masker.finish();
+        write_intervals();
+    }
+
+    void finish() override
+    {
+        out->finish();
+    }
+
+    // every position of the current record before this one is final
+    size_t decided() const
+    {
+        return masker.decided();
+    }
+
+    // the intervals written since the last call, in record coordinates
+    std::vector<std::pair<size_t, size_t>> take_intervals()
+    {
+        return std::exchange(written, {});
+    }
+
+    // keep the written intervals for take_intervals, e.g. to mask the bases
+    void keep_intervals()
+    {
+        keep = true;
+    }
+
+private:
+    std::unique_ptr<byte_output> out;
+    interval_masker masker;
+    std::string chrom{};
+    size_t offset{0};
+    bool keep{false};
+    std::vector<std::pair<size_t, size_t>> written{};
+    std::string text{};
+
+    void write_intervals()
+    {
+        std::vector<std::pair<size_t, size_t>> intervals = masker.take_intervals();
+        if (intervals.empty())
+        {
+            return;
+        }
+        text.clear();
+        char number[24];
+        for (auto [start, end] : intervals)
+        {
+            text += chrom;
+            for (size_t value : {offset + start, offset + end})
+            {
+                text += '\t';
+                text.append(number, std::to_chars(number, number + sizeof(number), value).ptr);
+            }
+            text += '\n';
+        }
+        out->write(text);
+        if (keep)
+        {
+            written.insert(written.end(), intervals.begin(), intervals.end());
+        }
+    }
+};
+
+} // namespace seqomplexity
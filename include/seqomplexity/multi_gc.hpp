@@ -0,0 +1,181 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include <seqomplexity/sliding_gc.hpp>
+
+namespace seqomplexity
+{
+
+// the GC content of several window sizes in one pass over the bases. the
+// bases are classified once and a running count of G and C, a prefix sum, is
+// kept in a ring of the last max_w + 1 positions. the count of a window of w
+// bases ending at position t is then prefix(t) - prefix(t - w) for every w.
+// the scores of every window size have the layout of window_engine.
+class multi_gc_engine
+{
+public:
+    static constexpr size_t block_size = 2048;
+
+    explicit multi_gc_engine(std::vector<size_t> wsizes) :
+        wsizes(std::move(wsizes))
+    {
+        if (this->wsizes.empty())
+        {
+            throw std::invalid_argument("At least one window size is required.");
+        }
+        for (size_t wsize : this->wsizes)
+        {
+            std::string error = sliding_gc::check_parameters(wsize);
+            if (!error.empty())
+            {
+                throw std::invalid_argument(error);
+            }
+        }
+        max_wsize = *std::max_element(this->wsizes.begin(), this->wsizes.end());
+        prefixes.resize(max_wsize + 1);
+        last_scores.resize(this->wsizes.size());
+    }
+
+    size_t n_windows() const
+    {
+        return wsizes.size();
+    }
+
+    size_t window_size(size_t j) const
+    {
+        return wsizes[j];
+    }
+
+    // the most scores push can write per window size for n_bases bases
+    size_t max_scores(size_t n_bases) const
+    {
+        return n_bases + max_wsize/2;
+    }
+
+    // the most scores finish can write per window size
+    size_t max_finish_scores() const
+    {
+        return max_wsize - 1;
+    }
+
+    // appends bases of the current record and writes the scores of window
+    // size j that are complete to out[j], which must hold max_scores(n)
+    // floats. n_written[j] receives their number.
+    void push(std::span<char const> bases, std::span<float * const> out, std::span<size_t> n_written)
+    {
+        std::fill(n_written.begin(), n_written.end(), 0);
+        uint32_t prefix[block_size];
+        uint32_t past[block_size];
+        char const * seq = bases.data();
+        size_t n = bases.size();
+        while (n > 0)
+        {
+            size_t m = std::min(n, block_size);
+            // prefix[i] is the count of the first n_bases + i + 1 bases
+            uint32_t count = prefixes[n_bases % prefixes.size()];
+            for (size_t i = 0; i < m; i++)
+            {
+                uint8_t c = uint8_t(seq[i]) | 0x20;
+                count += (c == 'c') | (c == 'g');
+                prefix[i] = count;
+            }
+            for (size_t j = 0; j < wsizes.size(); j++)
+            {
+                size_t wsize = wsizes[j];
+                // the first base of the block that completes a window
+                size_t first = n_bases + 1 >= wsize ? 0 : wsize - n_bases - 1;
+                if (first >= m)
+                {
+                    continue;
+                }
+                // the counts before the windows, from the ring up to the
+                // start of the block and from the block after it
+                size_t from_ring = std::min(m, wsize);
+                if (first < from_ring)
+                {
+                    read_ring(n_bases + 1 + first - wsize, past + first, from_ring - first);
+                }
+                for (size_t i = std::max(first, from_ring); i < m; i++)
+                {
+                    past[i] = prefix[i - wsize];
+                }
+                float * o = out[j] + n_written[j];
+                float const w = float(wsize);
+                if (n_bases + 1 + first == wsize)
+                {
+                    // padding to fill the first half of the window
+                    o = std::fill_n(o, wsize/2, float(prefix[first] - past[first]) / w);
+                }
+                for (size_t i = first; i < m; i++)
+                {
+                    o[i - first] = float(prefix[i] - past[i]) / w;
+                }
+                last_scores[j] = o[m - 1 - first];
+                n_written[j] = size_t(o + (m - first) - out[j]);
+            }
+            write_ring(n_bases + 1, prefix, m);
+            n_bases += m;
+            seq += m;
+            n -= m;
+        }
+    }
+
+    // ends the current record and writes the remaining scores of window size
+    // j to out[j], which must hold max_finish_scores() floats
+    void finish(std::span<float * const> out, std::span<size_t> n_written)
+    {
+        for (size_t j = 0; j < wsizes.size(); j++)
+        {
+            size_t wsize = wsizes[j];
+            n_written[j] = n_bases < wsize ? n_bases : (wsize-1)/2;
+            std::fill_n(out[j], n_written[j], n_bases < wsize ? 0.0f : last_scores[j]);
+        }
+        reset();
+    }
+
+    // drops the current record
+    void reset()
+    {
+        n_bases = 0;
+        // the count before the first base, older slots are never read
+        prefixes[0] = 0;
+    }
+
+private:
+    std::vector<size_t> wsizes;
+    size_t max_wsize{0};
+    size_t n_bases{0};
+    // the prefix count after t bases at slot t % (max_wsize + 1)
+    std::vector<uint32_t> prefixes{};
+    std::vector<float> last_scores{};
+
+    void read_ring(size_t t, uint32_t * out, size_t n) const
+    {
+        size_t start = t % prefixes.size();
+        size_t first = std::min(n, prefixes.size() - start);
+        std::copy(prefixes.data() + start, prefixes.data() + start + first, out);
+        std::copy(prefixes.data(), prefixes.data() + (n - first), out + first);
+    }
+
+    // stores the prefix counts after t, t + 1, ... bases, only the last
+    // max_wsize + 1 of them are kept
+    void write_ring(size_t t, uint32_t const * in, size_t n)
+    {
+        size_t kept = std::min(n, prefixes.size());
+        t += n - kept;
+        in += n - kept;
+        size_t start = t % prefixes.size();
+        size_t first = std::min(kept, prefixes.size() - start);
+        std::copy(in, in + first, prefixes.data() + start);
+        std::copy(in + first, in + kept, prefixes.data());
+    }
+};
+
+} // namespace seqomplexity
@@ -0,0 +1,156 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include <seqomplexity/output_file.hpp>
+#include <seqomplexity/score_format.hpp>
+#include <seqomplexity/score_sink.hpp>
+
+namespace seqomplexity
+{
+
+// inserts a label in front of the extension of an output path, e.g.
+// gc.f32 and w100 give gc.w100.f32. a .gz or .bgz suffix stays last.
+inline std::string track_path(std::string const & path, std::string const & label)
+{
+    size_t end = path.size();
+    for (char const * suffix : {".gz", ".bgz"})
+    {
+        if (path.ends_with(suffix))
+        {
+            end -= std::string(suffix).size();
+            break;
+        }
+    }
+    size_t name_start = path.find_last_of('/') + 1;
+    size_t dot = path.find_last_of('.', end == 0 ? 0 : end - 1);
+    if (dot == std::string::npos || dot < name_start || dot == name_start)
+    {
+        dot = end;
+    }
+    return path.substr(0, dot) + '.' + label + path.substr(dot);
+}
+
+// several tracks over the same records, e.g. the GC content of several
+// window sizes. every track goes to a sink of its own, or all tracks are
+// written as text with one tab separated column per track. the scores of
+// the tracks may arrive at different times, columns are written once all
+// tracks reached them.
+class multi_track_output
+{
+public:
+    // one sink per track
+    explicit multi_track_output(std::vector<std::unique_ptr<score_sink>> sinks) :
+        sinks(std::move(sinks))
+    {}
+
+    // one column per track
+    multi_track_output(std::unique_ptr<byte_output> out, size_t n_tracks, int precision) :
+        out(std::move(out)),
+        precision(precision),
+        pending(n_tracks)
+    {}
+
+    size_t n_tracks() const
+    {
+        return out ? pending.size() : sinks.size();
+    }
+
+    void begin_record(std::string const & name)
+    {
+        for (std::unique_ptr<score_sink> & sink : sinks)
+        {
+            sink->begin_record(name);
+        }
+    }
+
+    // appends n scores of track j to the current record
+    void write(size_t j, float const * scores, size_t n)
+    {
+        if (!out)
+        {
+            sinks[j]->write(scores, n);
+            return;
+        }
+        pending[j].insert(pending[j].end(), scores, scores + n);
+    }
+
+    // writes the columns that all tracks reached, call after writing to the tracks
+    void flush()
+    {
+        if (!out)
+        {
+            return;
+        }
+        size_t n_rows = pending[0].size();
+        for (std::vector<float> const & column : pending)
+        {
+            n_rows = std::min(n_rows, column.size());
+        }
+        if (n_rows == 0)
+        {
+            return;
+        }
+        text.resize(n_rows * pending.size() * max_score_chars);
+        char * pos = text.data();
+        for (size_t i = 0; i < n_rows; i++)
+        {
+            for (std::vector<float> const & column : pending)
+            {
+                pos = format_score(pos, column[i], precision);
+                pos[-1] = '\t';
+            }
+            pos[-1] = '\n';
+        }
+        text.resize(pos - text.data());
+        out->write(text);
+        for (std::vector<float> & column : pending)
+        {
+            column.erase(column.begin(), column.begin() + n_rows);
+        }
+    }
+
+    // all tracks must have the same number of scores at the end of a record
+    void end_record()
+    {
+        flush();
+        for (std::vector<float> const & column : pending)
+        {
+            if (!column.empty())
+            {
+                throw std::logic_error("the tracks of a record differ in length.");
+            }
+        }
+        for (std::unique_ptr<score_sink> & sink : sinks)
+        {
+            sink->end_record();
+        }
+    }
+
+    void finish()
+    {
+        if (out)
+        {
+            out->finish();
+        }
+        for (std::unique_ptr<score_sink> & sink : sinks)
+        {
+            sink->finish();
+        }
+    }
+
+private:
+    std::vector<std::unique_ptr<score_sink>> sinks{};
+    std::unique_ptr<byte_output> out{};
+    int precision{default_precision};
+    // the scores of every track not yet written as columns
+    std::vector<std::vector<float>> pending{};
+    std::string text{};
+};
+
+} // namespace seqomplexity
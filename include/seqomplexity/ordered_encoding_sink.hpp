@@ -0,0 +1,178 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include <seqomplexity/score_sink.hpp>
+#include <seqomplexity/work_stealing_pool.hpp>
+
+namespace seqomplexity
+{
+
+// moves the encoding of a sink onto worker threads. the scores are collected
+// in batches, every batch is encoded by a worker and the calling thread writes
+// the encoded batches in their original order. the sink has to support
+// encodes_in_parallel.
+class ordered_encoding_sink : public score_sink
+{
+public:
+    static constexpr size_t default_batch_size = size_t(1) << 16;
+
+    ordered_encoding_sink(score_sink & target, size_t n_threads, size_t batch_size = default_batch_size) :
+        target(target),
+        batch_size(batch_size),
+        max_slots_in_flight(4 * n_threads),
+        pool(n_threads)
+    {
+        batch.reserve(batch_size);
+    }
+
+    void begin_record(std::string const & name) override
+    {
+        submit_batch();
+        enqueue(std::make_unique<slot>(slot::begin, name));
+    }
+
+    void begin_region(std::string const & chrom, size_t start, size_t end) override
+    {
+        submit_batch();
+        std::unique_ptr<slot> s = std::make_unique<slot>(slot::region, chrom);
+        s->region_start = start;
+        s->region_end = end;
+        enqueue(std::move(s));
+    }
+
+    void write(float const * scores, size_t n) override
+    {
+        while (n > 0)
+        {
+            size_t chunk = std::min(n, batch_size - batch.size());
+            batch.insert(batch.end(), scores, scores + chunk);
+            scores += chunk;
+            n -= chunk;
+            if (batch.size() == batch_size)
+            {
+                submit_batch();
+            }
+        }
+    }
+
+    void end_record() override
+    {
+        submit_batch();
+        enqueue(std::make_unique<slot>(slot::end, std::string()));
+    }
+
+    void finish() override
+    {
+        submit_batch();
+        while (!slots.empty())
+        {
+            write_front(true);
+        }
+        target.finish();
+    }
+
+private:
+    // one entry of the ordered output, records boundaries are ready at once
+    struct slot
+    {
+        enum kind_t { begin, region, data, end };
+
+        slot(kind_t kind, std::string bytes) :
+            kind(kind),
+            bytes(std::move(bytes)),
+            ready(kind != data)
+        {}
+
+        kind_t kind;
+        // the record name of begin and region, the encoded scores of data
+        std::string bytes;
+        // the bases of a region
+        size_t region_start{0};
+        size_t region_end{0};
+        std::vector<float> scores{};
+        std::atomic<bool> ready;
+    };
+
+    score_sink & target;
+    size_t batch_size;
+    size_t max_slots_in_flight;
+    std::vector<float> batch{};
+    std::deque<std::unique_ptr<slot>> slots{};
+    std::mutex ready_mutex{};
+    std::condition_variable slot_ready{};
+    // declared last so its workers are joined before the slots are freed
+    work_stealing_pool pool;
+
+    void submit_batch()
+    {
+        if (batch.empty())
+        {
+            return;
+        }
+        std::unique_ptr<slot> s = std::make_unique<slot>(slot::data, std::string());
+        s->scores.swap(batch);
+        batch.reserve(batch_size);
+        slot & queued = *s;
+        pool.submit([this, &queued](size_t)
+        {
+            target.encode(queued.scores.data(), queued.scores.size(), queued.bytes);
+            queued.scores = std::vector<float>();
+            std::lock_guard<std::mutex> lock(ready_mutex);
+            queued.ready = true;
+            slot_ready.notify_all();
+        });
+        enqueue(std::move(s));
+    }
+
+    // writes the finished slots at the front and bounds the slots in flight
+    void enqueue(std::unique_ptr<slot> s)
+    {
+        slots.push_back(std::move(s));
+        while (!slots.empty() && write_front(slots.size() > max_slots_in_flight))
+        {}
+    }
+
+    // writes the first slot, with wait set it blocks until the slot is ready.
+    // returns false if the slot was not ready yet.
+    bool write_front(bool wait)
+    {
+        slot & front = *slots.front();
+        if (wait)
+        {
+            std::unique_lock<std::mutex> lock(ready_mutex);
+            slot_ready.wait(lock, [&]() { return front.ready.load(); });
+        }
+        else if (!front.ready)
+        {
+            return false;
+        }
+        switch (front.kind)
+        {
+            case slot::begin:
+                target.begin_record(front.bytes);
+                break;
+            case slot::region:
+                target.begin_region(front.bytes, front.region_start, front.region_end);
+                break;
+            case slot::data:
+                target.write_encoded(front.bytes);
+                break;
+            case slot::end:
+                target.end_record();
+                break;
+        }
+        slots.pop_front();
+        return true;
+    }
+};
+
+} // namespace seqomplexity
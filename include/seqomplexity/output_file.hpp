@@ -0,0 +1,160 @@
+#pragma once
+
+#include <cerrno>
+#include <cstddef>
+#include <cstring>
+#include <string>
+#include <system_error>
+#include <vector>
+
+#include <fcntl.h>
+#include <unistd.h>
+
+namespace seqomplexity
+{
+
+// a sequential stream of output bytes
+class byte_output
+{
+public:
+    virtual ~byte_output() = default;
+
+    virtual void write(void const * data, size_t n) = 0;
+    // writes everything that is still buffered, called once at the end
+    virtual void finish() = 0;
+
+    void write(std::string const & bytes)
+    {
+        write(bytes.data(), bytes.size());
+    }
+};
+
+// writes to a file descriptor in large sequential chunks. the file is either
+// created from a path or an already open descriptor such as stdout is used.
+class output_file : public byte_output
+{
+public:
+    static constexpr size_t default_buffer_size = size_t(1) << 20;
+
+    explicit output_file(std::string const & path, size_t buffer_size = default_buffer_size) :
+        fd(::open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644)),
+        owns_fd(true)
+    {
+        if (fd < 0)
+        {
+            throw std::system_error(errno, std::generic_category(), "could not create " + path);
+        }
+        buffer.reserve(buffer_size);
+    }
+
+    explicit output_file(int fd, size_t buffer_size = default_buffer_size) :
+        fd(fd),
+        owns_fd(false)
+    {
+        buffer.reserve(buffer_size);
+    }
+
+    output_file(output_file const &) = delete;
+    output_file & operator=(output_file const &) = delete;
+
+    ~output_file()
+    {
+        // errors can not be reported here, call flush before to see them
+        try
+        {
+            flush();
+        }
+        catch (std::system_error const &)
+        {}
+        if (owns_fd)
+        {
+            ::close(fd);
+        }
+    }
+
+    using byte_output::write;
+
+    void write(void const * data, size_t n) override
+    {
+        char const * bytes = static_cast<char const *>(data);
+        if (buffer.size() + n > buffer.capacity())
+        {
+            flush();
+            // large writes bypass the buffer
+            if (n >= buffer.capacity())
+            {
+                write_all(bytes, n);
+                return;
+            }
+        }
+        buffer.insert(buffer.end(), bytes, bytes + n);
+    }
+
+    void finish() override
+    {
+        flush();
+    }
+
+    void flush()
+    {
+        if (!buffer.empty())
+        {
+            write_all(buffer.data(), buffer.size());
+            buffer.clear();
+        }
+    }
+
+    // number of bytes written so far, including the buffered ones
+    size_t position() const
+    {
+        return written + buffer.size();
+    }
+
+    // overwrites bytes that were already flushed, e.g. to patch a header
+    void write_at(size_t offset, void const * data, size_t n)
+    {
+        char const * bytes = static_cast<char const *>(data);
+        while (n > 0)
+        {
+            ssize_t w = ::pwrite(fd, bytes, n, off_t(offset));
+            if (w < 0)
+            {
+                if (errno == EINTR)
+                {
+                    continue;
+                }
+                throw std::system_error(errno, std::generic_category(), "could not write the output");
+            }
+            bytes += w;
+            offset += size_t(w);
+            n -= size_t(w);
+        }
+    }
+
+private:
+    int fd;
+    bool owns_fd;
+    size_t written{0};
+    std::vector<char> buffer{};
+
+    void write_all(char const * bytes, size_t n)
+    {
+        while (n > 0)
+        {
+            ssize_t w = ::write(fd, bytes, n);
+            if (w < 0)
+            {
+                if (errno == EINTR)
+                {
+                    continue;
+                }
+                throw std::system_error(errno, std::generic_category(), "could not write the output");
+            }
+            bytes += w;
+            n -= size_t(w);
+            written += size_t(w);
+        }
+    }
+};
+
+} // namespace seqomplexity
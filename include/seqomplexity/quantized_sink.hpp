@@ -0,0 +1,215 @@
+#pragma once
+
+#include <algorithm>
+#include <bit>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include <seqomplexity/output_file.hpp>
+#include <seqomplexity/score_sink.hpp>
+#include <seqomplexity/track_format.hpp>
+
+namespace seqomplexity
+{
+
+// appends an unsigned integer as LEB128 varint
+inline void put_varint(std::string & out, uint64_t value)
+{
+    while (value >= 0x80)
+    {
+        out.push_back(char(uint8_t(value) | 0x80));
+        value >>= 7;
+    }
+    out.push_back(char(uint8_t(value)));
+}
+
+// reads a LEB128 varint, throws if it runs past end
+inline uint64_t get_varint(char const *& pos, char const * end)
+{
+    uint64_t value(0);
+    for (unsigned shift = 0; pos != end && shift < 64; shift += 7)
+    {
+        uint8_t byte = uint8_t(*pos++);
+        value |= uint64_t(byte & 0x7f) << shift;
+        if ((byte & 0x80) == 0)
+        {
+            return value;
+        }
+    }
+    throw std::runtime_error("truncated varint in a quantized track.");
+}
+
+// compact track of scores quantized to uint8 or uint16. it starts with a
+// track_header of magic "SQXQUANT", version 1 and value type 1 = uint8 or
+// 2 = uint16, followed by (little endian)
+//     offset  bytes
+//     48      4     values per block
+//     52      4     scale as float32, a stored value q means the score q / scale
+//     56      nk    the k values, one byte each
+// scores are rounded to the nearest step of 1 / scale and clamped to
+// [0, max / scale], with max = 255 or 65535 and scale = max. scores above 1
+// are only possible with N bases and are stored as 1.
+// every record is cut into blocks of a fixed number of values, each block is
+// coded on its own so it can be decoded without the blocks before it. a block
+// is a sequence of tokens, every token is the zigzag coded difference to the
+// previous value (0 before the first one) as varint. a difference of 0 is
+// followed by a varint with the number of further repeats of the value.
+// the record table at the end holds for every record the number of values
+// (8 bytes), its first block (8 bytes), the name length (4 bytes) and the
+// name, followed by the block_table.
+class quantized_sink : public score_sink
+{
+public:
+    static constexpr char magic[9] = "SQXQUANT";
+    static constexpr uint32_t version = 1;
+    static constexpr uint32_t uint8_values = 1;
+    static constexpr uint32_t uint16_values = 2;
+    static constexpr uint32_t default_block_size = uint32_t(1) << 16;
+
+    quantized_sink(
+            std::string const & path,
+            uint32_t value_type,
+            size_t wsize,
+            std::vector<uint8_t> const & kmers,
+            uint32_t block_size = default_block_size) :
+        file(path),
+        block_size(block_size),
+        max_value(value_type == uint8_values ? 0xff : 0xffff),
+        scale(float(max_value))
+    {
+        std::string header = track_header::write(magic, version, value_type, wsize, kmers.size());
+        put_le(header, block_size);
+        put_le(header, std::bit_cast<uint32_t>(scale));
+        track_header::append_kmers(header, kmers);
+        file.write(header);
+        values.reserve(block_size);
+    }
+
+    void begin_record(std::string const & name) override
+    {
+        records.push_back(record_entry{name, 0, blocks.size()});
+    }
+
+    void write(float const * scores, size_t n) override
+    {
+        for (size_t i = 0; i < n; i++)
+        {
+            values.push_back(quantize(scores[i]));
+            if (values.size() == block_size)
+            {
+                write_block();
+            }
+        }
+    }
+
+    void end_record() override
+    {
+        write_block();
+    }
+
+    void finish() override
+    {
+        uint64_t table_offset = file.position();
+        std::string table;
+        for (record_entry const & record : records)
+        {
+            put_le(table, uint64_t(record.length));
+            put_le(table, uint64_t(record.first_block));
+            put_le(table, uint32_t(record.name.size()));
+            table += record.name;
+        }
+        blocks.write(table, table_offset);
+        file.write(table);
+        file.flush();
+        track_header::write_counts(file, records.size(), table_offset);
+    }
+
+    uint16_t quantize(float score) const
+    {
+        // NaN and negative scores become 0
+        if (!(score > 0.0f))
+        {
+            return 0;
+        }
+        return uint16_t(std::min(std::lround(score * scale), long(max_value)));
+    }
+
+    // decodes a block of n values written by this sink
+    static void decode_block(char const * data, size_t n_bytes, size_t n, uint16_t * out)
+    {
+        char const * pos = data;
+        char const * end = data + n_bytes;
+        uint32_t value(0);
+        size_t i(0);
+        while (i < n)
+        {
+            uint64_t token = get_varint(pos, end);
+            int64_t delta = int64_t(token >> 1) ^ -int64_t(token & 1);
+            value = uint32_t(int64_t(value) + delta);
+            out[i++] = uint16_t(value);
+            if (delta == 0)
+            {
+                uint64_t repeats = get_varint(pos, end);
+                if (repeats > n - i)
+                {
+                    throw std::runtime_error("corrupt block in a quantized track.");
+                }
+                std::fill(out + i, out + i + repeats, uint16_t(value));
+                i += repeats;
+            }
+        }
+    }
+
+private:
+    struct record_entry
+    {
+        std::string name;
+        size_t length;
+        size_t first_block;
+    };
+
+    output_file file;
+    uint32_t block_size;
+    uint32_t max_value;
+    float scale;
+    std::vector<uint16_t> values{};
+    std::string encoded{};
+    std::vector<record_entry> records{};
+    block_table blocks{};
+
+    void write_block()
+    {
+        if (values.empty())
+        {
+            return;
+        }
+        encoded.clear();
+        uint16_t previous(0);
+        for (size_t i = 0; i < values.size(); i++)
+        {
+            int64_t delta = int64_t(values[i]) - int64_t(previous);
+            put_varint(encoded, uint64_t((delta << 1) ^ (delta >> 63)));
+            previous = values[i];
+            if (delta == 0)
+            {
+                size_t run_end = i + 1;
+                while (run_end < values.size() && values[run_end] == previous)
+                {
+                    run_end++;
+                }
+                put_varint(encoded, run_end - i - 1);
+                i = run_end - 1;
+            }
+        }
+        blocks.add(file.position());
+        records.back().length += values.size();
+        file.write(encoded);
+        values.clear();
+    }
+};
+
+} // namespace seqomplexity
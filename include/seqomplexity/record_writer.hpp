@@ -0,0 +1,77 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <span>
+#include <string>
+#include <vector>
+
+#include <seqomplexity/fasta_reader.hpp>
+#include <seqomplexity/score_sink.hpp>
+
+namespace seqomplexity
+{
+
+// a fasta_reader handler that streams the scores of every record to a sink
+// while its bases come in. the scores of an engine are collected in a batch
+// and passed to the sink once the batch is full, so the sink sees few large
+// writes even if the bases come in short lines.
+template <typename engine_t>
+class record_writer
+{
+public:
+    static constexpr size_t batch_size = size_t(1) << 16;
+
+    record_writer(engine_t & engine, score_sink & sink) :
+        engine(engine),
+        sink(sink),
+        batch(std::max(engine.max_scores(batch_size), engine.max_finish_scores()))
+    {}
+
+    void begin_record(std::string const & header)
+    {
+        engine.reset();
+        sink.begin_record(record_name(header));
+    }
+
+    void bases(char const * seq, size_t n)
+    {
+        while (n > 0)
+        {
+            size_t m = std::min(n, batch_size);
+            if (used + engine.max_scores(m) > batch.size())
+            {
+                write_batch();
+            }
+            used += engine.push(std::span<char const>(seq, m), std::span<float>(batch).subspan(used));
+            seq += m;
+            n -= m;
+        }
+    }
+
+    // every record is padded at both ends
+    void end_record()
+    {
+        if (used + engine.max_finish_scores() > batch.size())
+        {
+            write_batch();
+        }
+        used += engine.finish(std::span<float>(batch).subspan(used));
+        write_batch();
+        sink.end_record();
+    }
+
+private:
+    engine_t & engine;
+    score_sink & sink;
+    std::vector<float> batch;
+    size_t used{0};
+
+    void write_batch()
+    {
+        sink.write(batch.data(), used);
+        used = 0;
+    }
+};
+
+} // namespace seqomplexity
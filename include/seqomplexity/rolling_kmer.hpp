@@ -0,0 +1,79 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+
+namespace seqomplexity
+{
+
+// rank of every character in the dna5 alphabet: A=0, C=1, G=2, T=3 (any case)
+// and N=4 for everything else.
+constexpr uint8_t dna5_n_rank = 4;
+
+namespace detail
+{
+constexpr std::array<uint8_t, 256> make_dna5_rank_table()
+{
+    std::array<uint8_t, 256> table{};
+    table.fill(dna5_n_rank);
+    table['A'] = table['a'] = 0;
+    table['C'] = table['c'] = 1;
+    table['G'] = table['g'] = 2;
+    table['T'] = table['t'] = 3;
+    return table;
+}
+} // namespace detail
+
+inline constexpr std::array<uint8_t, 256> dna5_rank_table = detail::make_dna5_rank_table();
+
+inline uint8_t dna5_rank(char c)
+{
+    return dna5_rank_table[static_cast<unsigned char>(c)];
+}
+
+// a dna5 k-mer packed with two bits per base. an N is stored as A in bases and
+// flagged in n_mask (one bit per base), so every k-mer has a unique value.
+struct packed_kmer
+{
+    uint64_t bases{0};
+    uint64_t n_mask{0};
+
+    bool operator==(packed_kmer const &) const = default;
+};
+
+// rolls a packed k-mer along a sequence. push appends a base and drops the
+// first one once k bases have been seen.
+class rolling_kmer
+{
+public:
+    static constexpr size_t max_k = 31;
+
+    explicit rolling_kmer(size_t k) :
+        bases_mask((uint64_t(1) << (2 * k)) - 1),
+        n_mask_mask((uint64_t(1) << k) - 1)
+    {}
+
+    void push(uint8_t rank)
+    {
+        kmer.bases = ((kmer.bases << 2) | (rank & 3)) & bases_mask;
+        kmer.n_mask = ((kmer.n_mask << 1) | (rank >> 2)) & n_mask_mask;
+    }
+
+    packed_kmer const & value() const
+    {
+        return kmer;
+    }
+
+    void reset()
+    {
+        kmer = packed_kmer{};
+    }
+
+private:
+    packed_kmer kmer{};
+    uint64_t bases_mask;
+    uint64_t n_mask_mask;
+};
+
+} // namespace seqomplexity
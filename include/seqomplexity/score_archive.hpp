@@ -0,0 +1,306 @@
+#pragma once
+
+#include <algorithm>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <stdexcept>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include <zlib.h>
+
+#include <seqomplexity/mapped_file.hpp>
+#include <seqomplexity/output_file.hpp>
+#include <seqomplexity/score_sink.hpp>
+#include <seqomplexity/track_format.hpp>
+
+namespace seqomplexity
+{
+
+// precomputed scores of a reference for random access. the scores of every
+// record are cut into blocks of block_size values, every block is compressed
+// on its own, so a region is read by inflating only the blocks it overlaps.
+// the file starts with a track_header of magic "SQXARCHV", version 1 and
+// the number of values per block as its field, followed by the k values.
+// a block holds the bytes of its float32 values split into four planes, the
+// lowest bytes of all values first, compressed with zlib. the record table at
+// the end holds for every record the number of values (8 bytes, little
+// endian), its first block (8 bytes), the name length (4 bytes) and the name,
+// followed by the block_table.
+struct score_archive_format
+{
+    static constexpr char magic[9] = "SQXARCHV";
+    static constexpr uint32_t version = 1;
+    static constexpr uint32_t default_block_size = 16384;
+
+    // splits the bytes of the values into planes, which zlib compresses
+    // better since close scores share their high bytes
+    static void shuffle(float const * values, size_t n, std::string & bytes)
+    {
+        bytes.resize(4 * n);
+        for (size_t i = 0; i < n; i++)
+        {
+            uint32_t bits = std::bit_cast<uint32_t>(values[i]);
+            for (size_t b = 0; b < 4; b++)
+            {
+                bytes[b * n + i] = char(uint8_t(bits >> (8 * b)));
+            }
+        }
+    }
+
+    static void unshuffle(unsigned char const * bytes, size_t n, float * values)
+    {
+        for (size_t i = 0; i < n; i++)
+        {
+            uint32_t bits = 0;
+            for (size_t b = 0; b < 4; b++)
+            {
+                bits |= uint32_t(bytes[b * n + i]) << (8 * b);
+            }
+            values[i] = std::bit_cast<float>(bits);
+        }
+    }
+};
+
+// writes the scores of every record into a score archive
+class score_archive_sink : public score_sink
+{
+public:
+    score_archive_sink(
+            std::string const & path,
+            size_t wsize,
+            std::vector<uint8_t> const & kmers,
+            size_t block_size = score_archive_format::default_block_size) :
+        file(path),
+        block_size(block_size)
+    {
+        if (block_size == 0 || block_size > (size_t(1) << 24))
+        {
+            throw std::invalid_argument("the block size must be between 1 and 2^24 values.");
+        }
+        std::string header = track_header::write(
+                score_archive_format::magic, score_archive_format::version, uint32_t(block_size), wsize, kmers.size());
+        track_header::append_kmers(header, kmers);
+        file.write(header);
+        block.reserve(block_size);
+    }
+
+    void begin_record(std::string const & name) override
+    {
+        records.push_back(record_entry{name, 0, blocks.size()});
+    }
+
+    void write(float const * scores, size_t n) override
+    {
+        records.back().length += n;
+        while (n > 0)
+        {
+            size_t m = std::min(n, block_size - block.size());
+            block.insert(block.end(), scores, scores + m);
+            if (block.size() == block_size)
+            {
+                write_block();
+            }
+            scores += m;
+            n -= m;
+        }
+    }
+
+    // blocks do not span records
+    void end_record() override
+    {
+        if (!block.empty())
+        {
+            write_block();
+        }
+    }
+
+    void finish() override
+    {
+        uint64_t table_offset = file.position();
+        std::string table;
+        for (record_entry const & record : records)
+        {
+            put_le(table, uint64_t(record.length));
+            put_le(table, uint64_t(record.first_block));
+            put_le(table, uint32_t(record.name.size()));
+            table += record.name;
+        }
+        blocks.write(table, table_offset);
+        file.write(table);
+        file.flush();
+        track_header::write_counts(file, records.size(), table_offset);
+    }
+
+private:
+    struct record_entry
+    {
+        std::string name;
+        size_t length;
+        size_t first_block;
+    };
+
+    output_file file;
+    size_t block_size;
+    std::vector<float> block{};
+    std::vector<record_entry> records{};
+    block_table blocks{};
+    std::string planes{};
+    std::string compressed{};
+
+    void write_block()
+    {
+        score_archive_format::shuffle(block.data(), block.size(), planes);
+        uLongf size = compressBound(uLong(planes.size()));
+        compressed.resize(size);
+        if (compress2(reinterpret_cast<Bytef *>(compressed.data()), &size,
+                      reinterpret_cast<Bytef const *>(planes.data()), uLong(planes.size()), Z_DEFAULT_COMPRESSION) != Z_OK)
+        {
+            throw std::runtime_error("could not compress a block of the score archive.");
+        }
+        blocks.add(file.position());
+        file.write(compressed.data(), size);
+        block.clear();
+    }
+};
+
+// reads regions of a score archive. the archive is memory mapped and only
+// the blocks overlapping a region are inflated, the last inflated block is
+// kept for queries close to each other. no scores are computed.
+class score_archive
+{
+public:
+    struct record_info
+    {
+        std::string name;
+        size_t length;
+        size_t first_block;
+    };
+
+    explicit score_archive(std::string const & path) :
+        file(path)
+    {
+        char const * data = file.data();
+        size_t size = file.size();
+        track_header header = track_header::read(data, size, score_archive_format::magic, path + " is not a score archive.");
+        if (header.version != score_archive_format::version)
+        {
+            throw std::runtime_error(path + " has an unsupported version.");
+        }
+        block_size = header.field;
+        wsize = header.wsize;
+        size_t pos = header.table_offset;
+        if (block_size == 0 || header.n_kmers > 32 || track_header::size + header.n_kmers > size || pos == 0 || pos > size)
+        {
+            throw std::runtime_error(path + " is truncated or damaged.");
+        }
+        kmer_values.assign(data + track_header::size, data + track_header::size + header.n_kmers);
+        auto need = [&](uint64_t n)
+        {
+            if (n > size - pos)
+            {
+                throw std::runtime_error(path + " is truncated or damaged.");
+            }
+        };
+        for (uint64_t r = 0; r < header.n_records; r++)
+        {
+            need(20);
+            record_info record{{}, get_le<uint64_t>(data + pos), get_le<uint64_t>(data + pos + 8)};
+            uint32_t name_length = get_le<uint32_t>(data + pos + 16);
+            pos += 20;
+            need(name_length);
+            record.name.assign(data + pos, name_length);
+            pos += name_length;
+            names.emplace(record.name, entries.size());
+            entries.push_back(std::move(record));
+        }
+        if (!blocks.read(data, size, pos))
+        {
+            throw std::runtime_error(path + " is truncated or damaged.");
+        }
+        for (record_info const & record : entries)
+        {
+            if (record.first_block + (record.length + block_size - 1) / block_size > blocks.size())
+            {
+                throw std::runtime_error(path + " is truncated or damaged.");
+            }
+        }
+    }
+
+    size_t window_size() const
+    {
+        return wsize;
+    }
+
+    std::vector<uint8_t> const & kmers() const
+    {
+        return kmer_values;
+    }
+
+    // the record of a name, nullptr if there is none
+    record_info const * find(std::string const & name) const
+    {
+        auto it = names.find(name);
+        return it == names.end() ? nullptr : &entries[it->second];
+    }
+
+    // the scores of the bases [start, end) of a record
+    void fetch(record_info const & record, size_t start, size_t end, std::vector<float> & out)
+    {
+        if (start > end || end > record.length)
+        {
+            throw std::out_of_range("the region is not part of " + record.name + ".");
+        }
+        out.resize(end - start);
+        float * pos = out.data();
+        while (start < end)
+        {
+            size_t b = start / block_size;
+            float const * values = inflate_block(record, b);
+            size_t stop = std::min(end, (b + 1) * block_size);
+            pos = std::copy(values + (start - b * block_size), values + (stop - b * block_size), pos);
+            start = stop;
+        }
+    }
+
+private:
+    mapped_file file;
+    size_t block_size{0};
+    size_t wsize{0};
+    std::vector<uint8_t> kmer_values{};
+    std::vector<record_info> entries{};
+    std::unordered_map<std::string, size_t> names{};
+    block_table blocks{};
+    // the last inflated block
+    size_t cached_block{SIZE_MAX};
+    std::vector<unsigned char> planes{};
+    std::vector<float> values{};
+
+    // the values of the b-th block of a record
+    float const * inflate_block(record_info const & record, size_t b)
+    {
+        size_t block = record.first_block + b;
+        if (block == cached_block)
+        {
+            return values.data();
+        }
+        size_t n = std::min(block_size, record.length - b * block_size);
+        size_t offset = blocks.offset(block);
+        size_t compressed = blocks.bytes(block);
+        planes.resize(4 * n);
+        uLongf size = uLongf(planes.size());
+        if (uncompress(planes.data(), &size, reinterpret_cast<Bytef const *>(file.data() + offset), uLong(compressed)) != Z_OK
+            || size != planes.size())
+        {
+            throw std::runtime_error("a block of the score archive is damaged.");
+        }
+        values.resize(n);
+        score_archive_format::unshuffle(planes.data(), n, values.data());
+        cached_block = block;
+        return values.data();
+    }
+};
+
+} // namespace seqomplexity
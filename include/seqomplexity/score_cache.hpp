@@ -0,0 +1,185 @@
+#pragma once
+
+#include <array>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <memory>
+#include <string>
+#include <system_error>
+#include <vector>
+
+#include <unistd.h>
+
+#include <seqomplexity/mapped_file.hpp>
+#include <seqomplexity/output_file.hpp>
+#include <seqomplexity/track_format.hpp>
+
+namespace seqomplexity
+{
+
+// a 128 bit hash of a record and the parameters that its scores depend on.
+// the bases are hashed with upper and lower case folded together, which the
+// scores do not distinguish either, so soft masked copies of a record share
+// their scores.
+struct record_key
+{
+    uint64_t high{0};
+    uint64_t low{0};
+
+    std::string hex() const
+    {
+        char text[33];
+        std::snprintf(text, sizeof(text), "%016llx%016llx", (unsigned long long)high, (unsigned long long)low);
+        return text;
+    }
+};
+
+// score arrays of whole records in a directory, one file per record named
+// after the hash of its bases, the window size, the k values and
+// scores_version. a file holds the magic "SQXCACHE", the number of scores (8
+// bytes, little endian) and the float32 scores from offset 64 on. files are
+// written under a temporary name and renamed, so concurrent runs sharing the
+// directory never see a partial file.
+class score_cache
+{
+public:
+    static constexpr char magic[9] = "SQXCACHE";
+    static constexpr size_t header_size = 64;
+    // the version of the scores a cache holds, part of every key. bump it in
+    // any change that can alter the score of a single base, e.g. the
+    // complexity formula, the padding at the ends of a record or the
+    // handling of N, so that caches written before miss instead of
+    // returning stale scores.
+    static constexpr uint32_t scores_version = 1;
+
+    score_cache(std::filesystem::path directory, size_t wsize, std::vector<uint8_t> const & kmers) :
+        directory(std::move(directory))
+    {
+        std::filesystem::create_directories(this->directory);
+        std::string parameters = "w=" + std::to_string(wsize) + " k=";
+        for (uint8_t k : kmers)
+        {
+            parameters += std::to_string(k) + ',';
+        }
+        parameters += " version=" + std::to_string(scores_version);
+        record_key seed = hash(parameters.data(), parameters.size(), {0x9e3779b97f4a7c15ull, 0xc2b2ae3d27d4eb4full});
+        seeds = {seed.high, seed.low};
+    }
+
+    record_key key(char const * bases, size_t n) const
+    {
+        return hash(bases, n, seeds, 0x2020202020202020ull);
+    }
+
+    // the cached scores of a record, empty if they are not cached. a record
+    // of n bases has n scores.
+    std::unique_ptr<mapped_file> load(record_key const & key, size_t n)
+    {
+        std::filesystem::path path = directory / (key.hex() + ".f32");
+        std::unique_ptr<mapped_file> file;
+        try
+        {
+            file = std::make_unique<mapped_file>(path.string());
+        }
+        catch (std::system_error const &)
+        {
+            misses++;
+            return nullptr;
+        }
+        uint64_t n_scores = file->size() >= header_size ? get_le<uint64_t>(file->data() + 8) : 0;
+        // the scores are mapped as they are, big endian machines recompute them
+        if (std::endian::native != std::endian::little || file->size() != header_size + 4 * n
+            || std::memcmp(file->data(), magic, 8) != 0 || n_scores != n)
+        {
+            misses++;
+            return nullptr;
+        }
+        // the scores are passed to the sink front to back
+        file->advise_sequential();
+        hits++;
+        bases_reused += n;
+        return file;
+    }
+
+    // the scores of a mapped cache file
+    static float const * scores(mapped_file const & file)
+    {
+        return reinterpret_cast<float const *>(file.data() + header_size);
+    }
+
+    void store(record_key const & key, std::vector<float> const & values)
+    {
+        std::filesystem::path path = directory / (key.hex() + ".f32");
+        std::filesystem::path temporary = directory / (key.hex() + ".f32." + std::to_string(::getpid()) + ".tmp");
+        {
+            output_file file(temporary.string());
+            std::string header(magic, 8);
+            put_le(header, uint64_t(values.size()));
+            header.resize(header_size, '\0');
+            file.write(header);
+            if constexpr (std::endian::native == std::endian::little)
+            {
+                file.write(values.data(), values.size() * sizeof(float));
+            }
+            else
+            {
+                std::string bytes;
+                for (float value : values)
+                {
+                    put_le(bytes, std::bit_cast<uint32_t>(value));
+                }
+                file.write(bytes);
+            }
+            file.flush();
+        }
+        std::filesystem::rename(temporary, path);
+    }
+
+    size_t hits{0};
+    size_t misses{0};
+    size_t bases_reused{0};
+
+private:
+    std::filesystem::path directory;
+    std::array<uint64_t, 2> seeds{};
+
+    static uint64_t rotate_multiply(uint64_t h, uint64_t word, uint64_t k1, uint64_t k2, int r)
+    {
+        return std::rotl(h ^ (word * k1), r) * k2;
+    }
+
+    static uint64_t finalise(uint64_t h)
+    {
+        h = (h ^ (h >> 30)) * 0xbf58476d1ce4e5b9ull;
+        h = (h ^ (h >> 27)) * 0x94d049bb133111ebull;
+        return h ^ (h >> 31);
+    }
+
+    // two independent lanes over words of 8 bytes, or-ed with fold first
+    static record_key hash(char const * bytes, size_t n, std::array<uint64_t, 2> seed, uint64_t fold = 0)
+    {
+        uint64_t h1 = seed[0] ^ n;
+        uint64_t h2 = seed[1] ^ (n * 0x9e3779b97f4a7c15ull);
+        size_t i(0);
+        for (; i + 8 <= n; i += 8)
+        {
+            uint64_t word;
+            std::memcpy(&word, bytes + i, 8);
+            word |= fold;
+            h1 = rotate_multiply(h1, word, 0x87c37b91114253d5ull, 0xbf58476d1ce4e5b9ull, 31);
+            h2 = rotate_multiply(h2, word, 0x4cf5ad432745937full, 0x94d049bb133111ebull, 33);
+        }
+        uint64_t word(0);
+        std::memcpy(&word, bytes + i, n - i);
+        word |= fold & ((n - i) == 0 ? 0 : ~uint64_t(0) >> (8 * (8 - (n - i))));
+        h1 = rotate_multiply(h1, word, 0x87c37b91114253d5ull, 0xbf58476d1ce4e5b9ull, 31);
+        h2 = rotate_multiply(h2, word, 0x4cf5ad432745937full, 0x94d049bb133111ebull, 33);
+        return record_key{finalise(h1 + h2), finalise(h2 ^ (h1 >> 1))};
+    }
+};
+
+} // namespace seqomplexity
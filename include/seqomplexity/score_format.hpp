@@ -0,0 +1,42 @@
+#pragma once
+
+#include <charconv>
+#include <cstddef>
+#include <string>
+
+namespace seqomplexity
+{
+
+// precision of format_score that keeps the format of std::ostream
+constexpr int default_precision = -1;
+// largest precision accepted by the tools, float has no more digits
+constexpr int max_precision = 9;
+// upper bound of the characters format_score writes, including the newline
+constexpr size_t max_score_chars = 64;
+
+// writes one score and a newline to out and returns the end of the written
+// characters. with default_precision the score looks like std::ostream prints
+// a float (%g with 6 significant digits), otherwise it gets precision digits
+// after the decimal point. no locale is involved.
+inline char * format_score(char * out, float score, int precision)
+{
+    std::to_chars_result result = precision == default_precision
+        ? std::to_chars(out, out + max_score_chars - 1, score, std::chars_format::general, 6)
+        : std::to_chars(out, out + max_score_chars - 1, score, std::chars_format::fixed, precision);
+    *result.ptr = '\n';
+    return result.ptr + 1;
+}
+
+// formats n scores, one per line, into text
+inline void format_scores(float const * scores, size_t n, int precision, std::string & text)
+{
+    text.resize(n * max_score_chars);
+    char * out = text.data();
+    for (size_t i = 0; i < n; i++)
+    {
+        out = format_score(out, scores[i], precision);
+    }
+    text.resize(out - text.data());
+}
+
+} // namespace seqomplexity
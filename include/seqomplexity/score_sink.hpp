@@ -0,0 +1,109 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <memory>
+#include <string>
+
+#include <seqomplexity/output_file.hpp>
+#include <seqomplexity/score_format.hpp>
+
+namespace seqomplexity
+{
+
+// receives the per base scores of one record after the other.
+// every output format of the tools is a score_sink.
+class score_sink
+{
+public:
+    virtual ~score_sink() = default;
+
+    virtual void begin_record(std::string const & name) = 0;
+    // a record holding the bases [start, end) of the sequence chrom
+    virtual void begin_region(std::string const & chrom, size_t start, size_t end)
+    {
+        begin_record(chrom + ':' + std::to_string(start) + '-' + std::to_string(end));
+    }
+    virtual void write(float const * scores, size_t n) = 0;
+    virtual void end_record() = 0;
+    // called once after the last record
+    virtual void finish() {}
+
+    // a sink whose encoding of a run of scores does not depend on the scores
+    // around it can let the worker threads encode, the encoded bytes are then
+    // passed to write_encoded in order. encode has to be thread safe.
+    virtual bool encodes_in_parallel() const
+    {
+        return false;
+    }
+
+    virtual void encode(float const *, size_t, std::string &) const
+    {}
+
+    virtual void write_encoded(std::string const &)
+    {}
+
+    // writes the same score n times, used for the padding at the record ends
+    void write_repeated(float score, size_t n)
+    {
+        std::array<float, 256> repeated;
+        repeated.fill(score);
+        while (n > 0)
+        {
+            size_t chunk = std::min(n, repeated.size());
+            write(repeated.data(), chunk);
+            n -= chunk;
+        }
+    }
+};
+
+// one score per line. the scores are formatted with std::to_chars into large
+// buffers, see format_score for the precision.
+class text_sink : public score_sink
+{
+public:
+    explicit text_sink(std::unique_ptr<byte_output> out, int precision = default_precision) :
+        out(std::move(out)),
+        precision(precision)
+    {}
+
+    void begin_record(std::string const &) override
+    {}
+
+    void write(float const * scores, size_t n) override
+    {
+        encode(scores, n, text);
+        out->write(text);
+    }
+
+    void end_record() override
+    {}
+
+    void finish() override
+    {
+        out->finish();
+    }
+
+    bool encodes_in_parallel() const override
+    {
+        return true;
+    }
+
+    void encode(float const * scores, size_t n, std::string & bytes) const override
+    {
+        format_scores(scores, n, precision, bytes);
+    }
+
+    void write_encoded(std::string const & bytes) override
+    {
+        out->write(bytes);
+    }
+
+private:
+    std::unique_ptr<byte_output> out;
+    int precision;
+    std::string text{};
+};
+
+} // namespace seqomplexity
@@ -0,0 +1,218 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <iterator>
+#include <memory>
+#include <optional>
+#include <ranges>
+#include <span>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include <seqan3/alphabet/nucleotide/dna5.hpp>
+
+#include <seqomplexity/engine.hpp>
+
+namespace seqomplexity
+{
+
+// the engine of a score adaptor and the buffers of its views, shared by all
+// views the adaptor makes so that a record does not build a new engine
+template <typename engine_t>
+struct score_workspace
+{
+    // bases read from the underlying range per push
+    static constexpr size_t block_size = size_t(1) << 16;
+
+    explicit score_workspace(engine_t engine) :
+        engine(std::move(engine)),
+        bases(block_size),
+        scores(std::max(this->engine.max_scores(block_size), this->engine.max_finish_scores()))
+    {}
+
+    engine_t engine;
+    std::vector<char> bases;
+    std::vector<float> scores;
+};
+
+// a lazy view of the scores of one sequence, one float per base, computed
+// by an engine while the bases are read from the underlying range in blocks.
+// the view is an input range that can be iterated once, its copies share the
+// position. views of the same workspace share its engine and buffers, only
+// one of them can be iterated at a time, e.g. one record after the other.
+template <std::ranges::input_range urng_t, typename engine_t>
+    requires std::ranges::view<urng_t>
+class score_view : public std::ranges::view_interface<score_view<urng_t, engine_t>>
+{
+private:
+    struct state
+    {
+        state(urng_t urange, std::shared_ptr<score_workspace<engine_t>> workspace) :
+            urange(std::move(urange)),
+            workspace(std::move(workspace))
+        {}
+
+        urng_t urange;
+        std::shared_ptr<score_workspace<engine_t>> workspace;
+        std::optional<std::ranges::iterator_t<urng_t>> it{};
+        // the scores of the last block pushed
+        float const * pending{nullptr};
+        size_t pending_pos{0};
+        size_t pending_size{0};
+        bool finished{false};
+
+        void start()
+        {
+            if (!it)
+            {
+                workspace->engine.reset();
+                it = std::ranges::begin(urange);
+                fill();
+            }
+        }
+
+        // pushes blocks of bases until a score is pending or the sequence is done
+        void fill()
+        {
+            score_workspace<engine_t> & w = *workspace;
+            pending = w.scores.data();
+            while (pending_pos == pending_size && !finished)
+            {
+                pending_pos = 0;
+                size_t n(0);
+                for (; n < w.bases.size() && *it != std::ranges::end(urange); ++*it)
+                {
+                    w.bases[n++] = seqan3::to_char(**it);
+                }
+                if (n > 0)
+                {
+                    pending_size = w.engine.push(std::span<char const>(w.bases.data(), n), w.scores);
+                }
+                else
+                {
+                    pending_size = w.engine.finish(w.scores);
+                    finished = true;
+                }
+            }
+        }
+    };
+
+public:
+    score_view(urng_t urange, std::shared_ptr<score_workspace<engine_t>> workspace) :
+        shared(std::make_shared<state>(std::move(urange), std::move(workspace)))
+    {}
+
+    class iterator
+    {
+    public:
+        using value_type = float;
+        using difference_type = std::ptrdiff_t;
+        using iterator_concept = std::input_iterator_tag;
+
+        iterator() = default;
+
+        explicit iterator(state * s) :
+            s(s)
+        {}
+
+        float operator*() const
+        {
+            return s->pending[s->pending_pos];
+        }
+
+        iterator & operator++()
+        {
+            if (++s->pending_pos == s->pending_size)
+            {
+                s->fill();
+            }
+            return *this;
+        }
+
+        void operator++(int)
+        {
+            ++*this;
+        }
+
+        friend bool operator==(iterator const & it, std::default_sentinel_t)
+        {
+            return it.s->pending_pos == it.s->pending_size;
+        }
+
+    private:
+        state * s{nullptr};
+    };
+
+    iterator begin()
+    {
+        shared->start();
+        return iterator(shared.get());
+    }
+
+    std::default_sentinel_t end() const
+    {
+        return std::default_sentinel;
+    }
+
+private:
+    std::shared_ptr<state> shared;
+};
+
+template <typename urng_t, typename engine_t>
+score_view(urng_t &&, std::shared_ptr<score_workspace<engine_t>>) -> score_view<std::views::all_t<urng_t>, engine_t>;
+
+// the range adaptor closure of a score view. it builds its engine once and
+// every view it is applied to resets and reuses it, so the views of one
+// adaptor must be iterated one after the other.
+template <typename engine_t>
+struct score_adaptor
+{
+    std::shared_ptr<score_workspace<engine_t>> workspace;
+
+    template <std::ranges::viewable_range urng_t>
+    auto operator()(urng_t && urange) const
+    {
+        return score_view(std::views::all(std::forward<urng_t>(urange)), workspace);
+    }
+
+    template <std::ranges::viewable_range urng_t>
+    friend auto operator|(urng_t && urange, score_adaptor const & adaptor)
+    {
+        return adaptor(std::forward<urng_t>(urange));
+    }
+};
+
+namespace views
+{
+
+// the sequence complexity of every base of a range of seqan3 nucleotides,
+// e.g. record.sequence() | seqomplexity::views::complexity(21, {2, 3, 4}).
+// throws std::invalid_argument if w and k can not be used.
+inline auto complexity(size_t wsize, std::vector<uint8_t> kmers)
+{
+    // fail here and not when the adaptor is applied
+    std::string error = sliding_complexity::check_parameters(wsize, kmers);
+    if (!error.empty())
+    {
+        throw std::invalid_argument(error);
+    }
+    return score_adaptor<complexity_engine>{std::make_shared<score_workspace<complexity_engine>>(complexity_engine(wsize, kmers))};
+}
+
+// the GC content of every base of a range of seqan3 nucleotides
+inline auto gc(size_t wsize)
+{
+    std::string error = sliding_gc::check_parameters(wsize);
+    if (!error.empty())
+    {
+        throw std::invalid_argument(error);
+    }
+    return score_adaptor<gc_engine>{std::make_shared<score_workspace<gc_engine>>(gc_engine(wsize))};
+}
+
+} // namespace views
+
+} // namespace seqomplexity
@@ -0,0 +1,100 @@
+#ifndef SEQOMPLEXITY_H
+#define SEQOMPLEXITY_H
+
+/*
+ * C interface of libseqomplexity, for bindings through ctypes, cffi or the
+ * R foreign function interface. all memory for scores is owned by the caller,
+ * e.g. a numpy float32 array, and is filled in place. the functions never
+ * throw, they return a status and sqx_last_error describes the last failure
+ * of the calling thread. an engine must not be used by several threads at
+ * the same time, use one engine per thread instead.
+ *
+ * every sequence of n >= w bases gets n scores: w/2 copies of the score of
+ * its first window, one score per window and (w-1)/2 copies of the score of
+ * its last window. a sequence shorter than the window gets n zeros. bases
+ * are characters, anything but ACGT in either case counts as N.
+ */
+
+#include <stddef.h>
+#include <stdint.h>
+
+#if defined(_WIN32)
+#define SQX_API __declspec(dllexport)
+#else
+#define SQX_API __attribute__((visibility("default")))
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* version of the interface, incremented on incompatible changes */
+#define SQX_ABI_VERSION 1
+
+typedef enum sqx_status
+{
+    SQX_OK = 0,
+    SQX_INVALID_ARGUMENT = 1,
+    SQX_BUFFER_TOO_SMALL = 2,
+    SQX_OUT_OF_MEMORY = 3,
+    SQX_ERROR = 4
+} sqx_status;
+
+typedef struct sqx_engine sqx_engine;
+
+SQX_API int sqx_abi_version(void);
+
+/* the message of the last failed call of this thread, never NULL */
+SQX_API char const * sqx_last_error(void);
+
+/* sequence complexity over windows of wsize bases for the n_kmers k values.
+ * returns NULL if the parameters can not be used or memory runs out. */
+SQX_API sqx_engine * sqx_complexity_engine_new(size_t wsize, uint8_t const * kmers, size_t n_kmers);
+
+/* GC content over windows of wsize bases, NULL on failure */
+SQX_API sqx_engine * sqx_gc_engine_new(size_t wsize);
+
+SQX_API void sqx_engine_free(sqx_engine * engine);
+
+SQX_API size_t sqx_engine_window_size(sqx_engine const * engine);
+
+/* scores a whole sequence of n bases into out, which must hold n floats */
+SQX_API sqx_status sqx_engine_score(sqx_engine * engine, char const * bases, size_t n, float * out, size_t out_size);
+
+/* scores n_sequences sequences stored back to back in bases, sequence i
+ * spans the bytes [offsets[i], offsets[i+1]). the scores are written back to
+ * back into out in the same layout, which must hold offsets[n_sequences]
+ * floats. */
+SQX_API sqx_status sqx_engine_score_batch(
+    sqx_engine * engine,
+    char const * bases,
+    size_t const * offsets,
+    size_t n_sequences,
+    float * out,
+    size_t out_size);
+
+/* streaming: the bases of one sequence may be fed in chunks of any size.
+ * sqx_engine_push writes the scores that are complete after the chunk and
+ * sqx_engine_finish the rest, then the engine is ready for the next
+ * sequence. n_written receives the number of scores written. out must hold
+ * sqx_engine_max_scores(engine, n) floats for a chunk of n bases and
+ * sqx_engine_max_finish_scores(engine) floats for finish. */
+SQX_API size_t sqx_engine_max_scores(sqx_engine const * engine, size_t n);
+SQX_API size_t sqx_engine_max_finish_scores(sqx_engine const * engine);
+SQX_API sqx_status sqx_engine_push(
+    sqx_engine * engine,
+    char const * bases,
+    size_t n,
+    float * out,
+    size_t out_size,
+    size_t * n_written);
+SQX_API sqx_status sqx_engine_finish(sqx_engine * engine, float * out, size_t out_size, size_t * n_written);
+
+/* drops a partly fed sequence */
+SQX_API void sqx_engine_reset(sqx_engine * engine);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,96 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include <unistd.h>
+
+#include <seqomplexity/bed_sink.hpp>
+#include <seqomplexity/bgzf_writer.hpp>
+#include <seqomplexity/bigwig_sink.hpp>
+#include <seqomplexity/binary_sink.hpp>
+#include <seqomplexity/quantized_sink.hpp>
+#include <seqomplexity/score_sink.hpp>
+
+namespace seqomplexity
+{
+
+// the output formats the tools can write
+inline std::vector<std::string> const & sink_formats()
+{
+    static std::vector<std::string> const formats{"text", "bed", "bedgraph", "bigwig", "f32", "u8", "u16"};
+    return formats;
+}
+
+// opens the output of the text formats, stdout for an empty path. a path
+// ending in .gz or .bgz is compressed to BGZF on n_threads threads.
+inline std::unique_ptr<byte_output> open_text_output(std::string const & path, size_t n_threads)
+{
+    if (path.empty())
+    {
+        return std::make_unique<output_file>(STDOUT_FILENO);
+    }
+    std::unique_ptr<byte_output> file = std::make_unique<output_file>(path);
+    if (path.ends_with(".gz") || path.ends_with(".bgz"))
+    {
+        return std::make_unique<bgzf_writer>(std::move(file), n_threads);
+    }
+    return file;
+}
+
+// creates the sink of an output format. an empty path means stdout, which
+// only works for the streamed formats. the precision is used by the text
+// formats only.
+inline std::unique_ptr<score_sink> make_score_sink(
+        std::string const & format,
+        std::string const & path,
+        size_t wsize,
+        std::vector<uint8_t> const & kmers,
+        int precision = default_precision,
+        size_t n_threads = 1)
+{
+    if (format == "text")
+    {
+        return std::make_unique<text_sink>(open_text_output(path, n_threads), precision);
+    }
+    if (format == "bed")
+    {
+        return std::make_unique<bed_sink>(open_text_output(path, n_threads), precision);
+    }
+    if (format == "bedgraph")
+    {
+        return std::make_unique<bedgraph_sink>(open_text_output(path, n_threads), precision);
+    }
+    if (format == "bigwig")
+    {
+        if (path.empty())
+        {
+            throw std::invalid_argument("--format bigwig needs an output file given with --output.");
+        }
+        return std::make_unique<bigwig_sink>(path);
+    }
+    if (format == "f32")
+    {
+        if (path.empty())
+        {
+            throw std::invalid_argument("--format f32 needs an output file given with --output.");
+        }
+        return std::make_unique<binary_sink>(path, wsize, kmers);
+    }
+    if (format == "u8" || format == "u16")
+    {
+        if (path.empty())
+        {
+            throw std::invalid_argument("--format " + format + " needs an output file given with --output.");
+        }
+        uint32_t value_type = format == "u8" ? quantized_sink::uint8_values : quantized_sink::uint16_values;
+        return std::make_unique<quantized_sink>(path, value_type, wsize, kmers);
+    }
+    throw std::invalid_argument("unknown output format " + format + ".");
+}
+
+} // namespace seqomplexity
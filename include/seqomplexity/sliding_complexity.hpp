@@ -0,0 +1,217 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include <seqomplexity/kmer_counter.hpp>
+#include <seqomplexity/rolling_kmer.hpp>
+
+namespace seqomplexity
+{
+
+// the sequence complexity of a sliding window of wsize bases: the product over
+// all k of the number of distinct k-mers in the window divided by the maximum
+// number of distinct k-mers, min(w-k+1, 4^k+1).
+// all window state lives on the heap, so windows of any size up to max_wsize
+// can be used and k can go up to rolling_kmer::max_k. a single rolling
+// register is read per base and every k is derived from it by masking.
+class sliding_complexity
+{
+public:
+    static constexpr size_t max_wsize = size_t(1) << 28;
+
+    // returns an error message if the parameters can not be used, else an empty string
+    static std::string check_parameters(size_t wsize, std::vector<uint8_t> const & kmers)
+    {
+        if (wsize < 2 || wsize > max_wsize)
+        {
+            return "The window size must be between 2 and " + std::to_string(max_wsize) + ".";
+        }
+        if (kmers.empty())
+        {
+            return "At least one kmer size is required.";
+        }
+        for (uint8_t k : kmers)
+        {
+            if (k < 1 || k > rolling_kmer::max_k)
+            {
+                return "Any kmer size must be between 1 and " + std::to_string(rolling_kmer::max_k) + ".";
+            }
+            if (k > wsize)
+            {
+                return "The window size must be larger than the maximum kmer size.";
+            }
+        }
+        return "";
+    }
+
+    sliding_complexity(size_t wsize, std::vector<uint8_t> const & kmers) :
+        wsize(wsize),
+        history(wsize)
+    {
+        std::string error = check_parameters(wsize, kmers);
+        if (!error.empty())
+        {
+            throw std::invalid_argument(error);
+        }
+        lanes.reserve(kmers.size());
+        for (uint8_t k : kmers)
+        {
+            lanes.emplace_back(k, wsize);
+            bases_masks.push_back((uint64_t(1) << (2 * k)) - 1);
+            n_masks.push_back((uint64_t(1) << k) - 1);
+        }
+        entering.resize(kmers.size());
+        leaving.resize(kmers.size());
+    }
+
+    // appends the next base (dna5 rank) and slides the window once it is full.
+    // returns true if the window holds wsize bases.
+    bool push(uint8_t rank)
+    {
+        // the k-mer of every k ending at a position is a suffix of the register
+        // at that position, so one register and one ring of its past values
+        // serve all k. history_pos is the slot of the base leaving the window.
+        n_bases++;
+        reg.push(rank);
+        packed_kmer const current = reg.value();
+        size_t const nk = lanes.size();
+        bool const sliding = n_bases > wsize;
+        // mask out the entering and leaving k-mers of all k in one sweep over
+        // flat arrays, which the compiler vectorises across the k lanes
+        for (size_t j = 0; j < nk; j++)
+        {
+            entering[j].bases = current.bases & bases_masks[j];
+            entering[j].n_mask = current.n_mask & n_masks[j];
+        }
+        if (sliding)
+        {
+            for (size_t j = 0; j < nk; j++)
+            {
+                size_t slot = history_pos + lanes[j].k - 1;
+                slot -= (slot >= wsize) ? wsize : 0;
+                leaving[j].bases = history[slot].bases & bases_masks[j];
+                leaving[j].n_mask = history[slot].n_mask & n_masks[j];
+            }
+        }
+        for (size_t j = 0; j < nk; j++)
+        {
+            if (n_bases < lanes[j].k)
+            {
+                continue;
+            }
+            if (sliding)
+            {
+                // a k-mer replacing an equal one does not change the counts
+                if (leaving[j] == entering[j])
+                {
+                    continue;
+                }
+                lanes[j].counter.remove(leaving[j]);
+            }
+            lanes[j].counter.add(entering[j]);
+        }
+        history[history_pos] = current;
+        if (++history_pos == wsize)
+        {
+            history_pos = 0;
+        }
+        return n_bases >= wsize;
+    }
+
+    // scores the n_windows windows starting at seq, which must hold
+    // n_windows + wsize - 1 bases. the state is reset first, so chunks of one
+    // sequence can be scored independently if they overlap by wsize - 1 bases.
+    void score_windows(char const * seq, size_t n_windows, float * scores)
+    {
+        reset();
+        for (size_t i = 0; i < wsize - 1; i++)
+        {
+            push(dna5_rank(seq[i]));
+        }
+        for (size_t i = 0; i < n_windows; i++)
+        {
+            push(dna5_rank(seq[wsize - 1 + i]));
+            scores[i] = score();
+        }
+    }
+
+    float score() const
+    {
+        float result(1.0);
+        for (kmer_lane const & lane : lanes)
+        {
+            result *= (float(lane.counter.distinct()) / float(lane.max_unique));
+        }
+        return result;
+    }
+
+    bool full() const
+    {
+        return n_bases >= wsize;
+    }
+
+    size_t window_size() const
+    {
+        return wsize;
+    }
+
+    // forgets all bases, e.g. at the start of a new record. only the k-mers
+    // still in the window are removed from the counters, so a reset costs
+    // O(w) instead of clearing the tables, which matters for many short records.
+    void reset()
+    {
+        for (kmer_lane & lane : lanes)
+        {
+            // the k-mer of lane k ending at base q (counted from 1) is in the
+            // window for q >= n_bases - wsize + k and sits at slot (q-1) % wsize
+            size_t window_kmers = std::min(n_bases + 1 - std::min(n_bases + 1, lane.k), wsize - lane.k + 1);
+            size_t slot = (history_pos + wsize - window_kmers) % wsize;
+            uint64_t bases_mask = (uint64_t(1) << (2 * lane.k)) - 1;
+            uint64_t n_mask = (uint64_t(1) << lane.k) - 1;
+            for (size_t i = 0; i < window_kmers; i++)
+            {
+                lane.counter.remove(packed_kmer{history[slot].bases & bases_mask, history[slot].n_mask & n_mask});
+                if (++slot == wsize)
+                {
+                    slot = 0;
+                }
+            }
+        }
+        n_bases = 0;
+        reg.reset();
+        history_pos = 0;
+    }
+
+private:
+    struct kmer_lane
+    {
+        kmer_lane(size_t k, size_t wsize) :
+            k(k),
+            max_unique(std::min(wsize - k + 1, (size_t(1) << (2 * k)) + 1)),
+            counter(k, wsize - k + 1)
+        {}
+
+        size_t k;
+        size_t max_unique;
+        kmer_counter counter;
+    };
+
+    size_t wsize;
+    size_t n_bases{0};
+    // the last max_k bases and the register values of the last wsize positions
+    rolling_kmer reg{rolling_kmer::max_k};
+    std::vector<packed_kmer> history;
+    size_t history_pos{0};
+    std::vector<kmer_lane> lanes{};
+    std::vector<uint64_t> bases_masks{};
+    std::vector<uint64_t> n_masks{};
+    std::vector<packed_kmer> entering{};
+    std::vector<packed_kmer> leaving{};
+};
+
+} // namespace seqomplexity
@@ -0,0 +1,156 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace seqomplexity
+{
+
+// the GC content of a sliding window of wsize bases: the number of C and G
+// bases in the window divided by wsize. the GC flags of the window are kept in
+// a ring, so any window size can be used.
+// score_bases slides the window over blocks of bases in separate passes over
+// flat arrays: the bases are classified, the running count is updated with
+// one add per base and the counts are turned into scores. the first and the
+// last pass have no dependencies between bases and are vectorised by the
+// compiler.
+class sliding_gc
+{
+public:
+    static constexpr size_t max_wsize = size_t(1) << 28;
+    // bases per pass of score_bases, the temporary arrays stay in the L1 cache
+    static constexpr size_t block_size = 2048;
+
+    // returns an error message if the window size can not be used, else an empty string
+    static std::string check_parameters(size_t wsize)
+    {
+        if (wsize < 1 || wsize > max_wsize)
+        {
+            return "The window size must be between 1 and " + std::to_string(max_wsize) + ".";
+        }
+        return "";
+    }
+
+    explicit sliding_gc(size_t wsize) :
+        wsize(wsize)
+    {
+        std::string error = check_parameters(wsize);
+        if (!error.empty())
+        {
+            throw std::invalid_argument(error);
+        }
+        flags.resize(wsize);
+    }
+
+    // appends the next base (dna5 rank) and slides the window once it is full.
+    // returns true if the window holds wsize bases.
+    bool push(uint8_t rank)
+    {
+        // C and G have the ranks 1 and 2
+        uint8_t gc = uint8_t(rank - 1) < 2;
+        n_gc += gc;
+        if (n_bases >= wsize)
+        {
+            n_gc -= flags[pos];
+        }
+        flags[pos] = gc;
+        if (++pos == wsize)
+        {
+            pos = 0;
+        }
+        n_bases++;
+        return n_bases >= wsize;
+    }
+
+    // slides the window over the next n bases, given as characters, and
+    // writes the score after every base into scores. the window must be full.
+    void score_bases(char const * seq, size_t n, float * scores)
+    {
+        uint8_t entering[block_size];
+        uint8_t leaving[block_size];
+        int32_t counts[block_size];
+        float const w = float(wsize);
+        while (n > 0)
+        {
+            size_t m = std::min(n, block_size);
+            for (size_t i = 0; i < m; i++)
+            {
+                uint8_t c = uint8_t(seq[i]) | 0x20;
+                entering[i] = (c == 'c') | (c == 'g');
+            }
+            // the bases leaving the window are in the ring, or in this block
+            // if the window is shorter than the block
+            size_t from_ring = std::min(m, wsize);
+            read_ring(pos, leaving, from_ring);
+            std::copy(entering, entering + (m - from_ring), leaving + from_ring);
+            int32_t count = int32_t(n_gc);
+            for (size_t i = 0; i < m; i++)
+            {
+                count += int32_t(entering[i]) - int32_t(leaving[i]);
+                counts[i] = count;
+            }
+            for (size_t i = 0; i < m; i++)
+            {
+                scores[i] = float(counts[i]) / w;
+            }
+            // only the last wsize flags stay in the ring
+            write_ring((pos + m - from_ring) % wsize, entering + m - from_ring, from_ring);
+            pos = (pos + m) % wsize;
+            n_gc = size_t(count);
+            n_bases += m;
+            seq += m;
+            scores += m;
+            n -= m;
+        }
+    }
+
+    float score() const
+    {
+        return float(n_gc) / float(wsize);
+    }
+
+    bool full() const
+    {
+        return n_bases >= wsize;
+    }
+
+    size_t window_size() const
+    {
+        return wsize;
+    }
+
+    // forgets all bases, e.g. at the start of a new record
+    void reset()
+    {
+        n_bases = 0;
+        n_gc = 0;
+        pos = 0;
+    }
+
+private:
+    size_t wsize;
+    size_t n_bases{0};
+    size_t n_gc{0};
+    size_t pos{0};
+    std::vector<uint8_t> flags{};
+
+    void read_ring(size_t start, uint8_t * out, size_t n) const
+    {
+        size_t first = std::min(n, wsize - start);
+        std::copy(flags.data() + start, flags.data() + start + first, out);
+        std::copy(flags.data(), flags.data() + (n - first), out + first);
+    }
+
+    void write_ring(size_t start, uint8_t const * in, size_t n)
+    {
+        size_t first = std::min(n, wsize - start);
+        std::copy(in, in + first, flags.data() + start);
+        std::copy(in + first, in + n, flags.data());
+    }
+};
+
+} // namespace seqomplexity
@@ -0,0 +1,103 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+namespace seqomplexity
+{
+
+// a bounded queue between one producer and one consumer thread. the ring is
+// indexed by two counters that only their owner advances, so push and pop
+// take no lock. a full or empty queue blocks in atomic wait instead of
+// spinning. the producer closes the queue after its last item, the consumer
+// cancels it to stop the producer, e.g. after an error. both set a flag bit
+// in their counter, which wakes the other side.
+template <typename value_t>
+class spsc_queue
+{
+public:
+    explicit spsc_queue(size_t capacity) :
+        slots(capacity)
+    {
+        if (capacity == 0)
+        {
+            throw std::invalid_argument("the queue needs room for at least one item.");
+        }
+    }
+
+    spsc_queue(spsc_queue const &) = delete;
+    spsc_queue & operator=(spsc_queue const &) = delete;
+
+    // waits for a free slot. returns false if the consumer cancelled.
+    bool push(value_t value)
+    {
+        size_t t = tail.load(std::memory_order_relaxed) & ~flag;
+        while (true)
+        {
+            size_t h = head.load(std::memory_order_acquire);
+            if (h & flag)
+            {
+                return false;
+            }
+            if (t - h < slots.size())
+            {
+                break;
+            }
+            head.wait(h, std::memory_order_acquire);
+        }
+        slots[t % slots.size()] = std::move(value);
+        tail.store(t + 1, std::memory_order_release);
+        tail.notify_one();
+        return true;
+    }
+
+    // waits for an item. returns false once the queue is closed and empty.
+    bool pop(value_t & value)
+    {
+        size_t h = head.load(std::memory_order_relaxed) & ~flag;
+        while (true)
+        {
+            size_t t = tail.load(std::memory_order_acquire);
+            if ((t & ~flag) != h)
+            {
+                break;
+            }
+            if (t & flag)
+            {
+                return false;
+            }
+            tail.wait(t, std::memory_order_acquire);
+        }
+        value = std::move(slots[h % slots.size()]);
+        head.store(h + 1, std::memory_order_release);
+        head.notify_one();
+        return true;
+    }
+
+    // called by the producer after its last push
+    void close()
+    {
+        tail.fetch_or(flag, std::memory_order_release);
+        tail.notify_one();
+    }
+
+    // called by the consumer, pushes fail from now on
+    void cancel()
+    {
+        head.fetch_or(flag, std::memory_order_release);
+        head.notify_one();
+    }
+
+private:
+    static constexpr size_t flag = size_t(1) << (sizeof(size_t) * 8 - 1);
+
+    std::vector<value_t> slots;
+    // the producer and the consumer counter on cache lines of their own
+    alignas(64) std::atomic<size_t> tail{0};
+    alignas(64) std::atomic<size_t> head{0};
+};
+
+} // namespace seqomplexity
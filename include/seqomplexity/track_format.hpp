@@ -0,0 +1,181 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include <seqomplexity/output_file.hpp>
+
+namespace seqomplexity
+{
+
+// appends an unsigned integer in little endian byte order
+template <typename uint_t>
+void put_le(std::string & out, uint_t value)
+{
+    for (size_t i = 0; i < sizeof(uint_t); i++)
+    {
+        out.push_back(char(uint8_t(value >> (8 * i))));
+    }
+}
+
+// reads an unsigned integer in little endian byte order
+template <typename uint_t, typename byte_t>
+uint_t get_le(byte_t const * bytes)
+{
+    uint_t value = 0;
+    for (size_t i = 0; i < sizeof(uint_t); i++)
+    {
+        value |= uint_t(uint8_t(bytes[i])) << (8 * i);
+    }
+    return value;
+}
+
+// the header the binary track, quantized track and score archive files start
+// with. all numbers are little endian.
+//     offset  bytes
+//     0       8     magic
+//     8       4     format version
+//     12      4     a field of the format, e.g. the value type
+//     16      8     window size w
+//     24      8     number of k values nk, 0 for GC content
+//     32      8     number of records, written at the end
+//     40      8     offset of the record table, written at the end
+// a format can add fields of its own after it, then follow the k values, one
+// byte each, and zeros up to the next multiple of 64.
+struct track_header
+{
+    static constexpr size_t size = 48;
+
+    uint32_t version{0};
+    uint32_t field{0};
+    uint64_t wsize{0};
+    uint64_t n_kmers{0};
+    uint64_t n_records{0};
+    uint64_t table_offset{0};
+
+    // the header with the counts left at 0, to be followed by the fields of
+    // the format and append_kmers
+    static std::string write(char const * magic, uint32_t version, uint32_t field, size_t wsize, size_t n_kmers)
+    {
+        std::string header(magic, 8);
+        put_le(header, version);
+        put_le(header, field);
+        put_le(header, uint64_t(wsize));
+        put_le(header, uint64_t(n_kmers));
+        put_le(header, uint64_t(0));
+        put_le(header, uint64_t(0));
+        return header;
+    }
+
+    static void append_kmers(std::string & header, std::vector<uint8_t> const & kmers)
+    {
+        header.append(kmers.begin(), kmers.end());
+        header.resize((header.size() + 63) / 64 * 64, '\0');
+    }
+
+    // fills in the counts once the record table is written
+    static void write_counts(output_file & file, size_t n_records, size_t table_offset)
+    {
+        std::string counts;
+        put_le(counts, uint64_t(n_records));
+        put_le(counts, uint64_t(table_offset));
+        file.write_at(32, counts.data(), counts.size());
+    }
+
+    // reads the header of a file of the given magic, throws
+    // std::runtime_error with message if the file is of another kind or too short
+    static track_header read(char const * data, size_t size, char const * magic, std::string const & message)
+    {
+        if (size < track_header::size || std::memcmp(data, magic, 8) != 0)
+        {
+            throw std::runtime_error(message);
+        }
+        return track_header{get_le<uint32_t>(data + 8),
+                            get_le<uint32_t>(data + 12),
+                            get_le<uint64_t>(data + 16),
+                            get_le<uint64_t>(data + 24),
+                            get_le<uint64_t>(data + 32),
+                            get_le<uint64_t>(data + 40)};
+    }
+};
+
+// the offsets of blocks written back to back, stored after the record table
+// as the number of blocks (8 bytes) and the offsets of all blocks and of the
+// end of the last block (8 bytes each). records refer to their first block.
+class block_table
+{
+public:
+    // the next block starts at offset
+    void add(size_t offset)
+    {
+        offsets.push_back(offset);
+    }
+
+    size_t size() const
+    {
+        return offsets.size();
+    }
+
+    // end is the offset behind the last block
+    void write(std::string & out, size_t end) const
+    {
+        put_le(out, uint64_t(offsets.size()));
+        for (size_t offset : offsets)
+        {
+            put_le(out, uint64_t(offset));
+        }
+        put_le(out, uint64_t(end));
+    }
+
+    // reads a table written at pos and moves pos behind it. returns false if
+    // the table runs past size or a block lies outside of it.
+    bool read(char const * data, size_t size, size_t & pos)
+    {
+        if (size - pos < 8)
+        {
+            return false;
+        }
+        uint64_t n_blocks = get_le<uint64_t>(data + pos);
+        pos += 8;
+        if (n_blocks >= (size - pos) / 8)
+        {
+            return false;
+        }
+        offsets.resize(n_blocks);
+        for (size_t b = 0; b < n_blocks; b++, pos += 8)
+        {
+            offsets[b] = get_le<uint64_t>(data + pos);
+        }
+        end = get_le<uint64_t>(data + pos);
+        pos += 8;
+        for (size_t b = 0; b < n_blocks; b++)
+        {
+            if (offsets[b] > (b + 1 < n_blocks ? offsets[b + 1] : end))
+            {
+                return false;
+            }
+        }
+        return end <= size;
+    }
+
+    size_t offset(size_t b) const
+    {
+        return offsets[b];
+    }
+
+    // the size of block b in bytes
+    size_t bytes(size_t b) const
+    {
+        return (b + 1 < offsets.size() ? offsets[b + 1] : end) - offsets[b];
+    }
+
+private:
+    std::vector<size_t> offsets{};
+    size_t end{0};
+};
+
+} // namespace seqomplexity
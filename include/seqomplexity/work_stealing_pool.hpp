@@ -0,0 +1,136 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace seqomplexity
+{
+
+// a fixed set of worker threads with one task queue each. submitted tasks are
+// spread over the queues, a worker takes tasks from the front of its own
+// queue and steals from the back of the other queues once its own is empty,
+// so long tasks on one worker do not leave the others idle.
+// every task gets the id of the worker running it, to use per worker state.
+class work_stealing_pool
+{
+public:
+    using task = std::function<void(size_t worker)>;
+
+    explicit work_stealing_pool(size_t n_workers)
+    {
+        for (size_t i = 0; i < n_workers; i++)
+        {
+            queues.push_back(std::make_unique<task_queue>());
+        }
+        for (size_t i = 0; i < n_workers; i++)
+        {
+            threads.emplace_back([this, i]() { run(i); });
+        }
+    }
+
+    // runs all remaining tasks before the workers are joined.
+    // tasks must only be submitted from a single thread.
+    ~work_stealing_pool()
+    {
+        {
+            std::lock_guard<std::mutex> lock(sleep_mutex);
+            stopping = true;
+        }
+        wake.notify_all();
+        for (std::thread & thread : threads)
+        {
+            thread.join();
+        }
+    }
+
+    size_t size() const
+    {
+        return threads.size();
+    }
+
+    void submit(task t)
+    {
+        {
+            // counted under the sleep mutex and before the task becomes
+            // visible, so a worker can neither miss the wake up nor see the
+            // counter drop below zero
+            std::lock_guard<std::mutex> lock(sleep_mutex);
+            queued++;
+        }
+        task_queue & queue = *queues[next_queue++ % queues.size()];
+        {
+            std::lock_guard<std::mutex> lock(queue.mutex);
+            queue.tasks.push_back(std::move(t));
+        }
+        wake.notify_one();
+    }
+
+private:
+    struct task_queue
+    {
+        std::mutex mutex;
+        std::deque<task> tasks;
+    };
+
+    std::vector<std::unique_ptr<task_queue>> queues{};
+    std::vector<std::thread> threads{};
+    std::mutex sleep_mutex{};
+    std::condition_variable wake{};
+    std::atomic<size_t> queued{0};
+    size_t next_queue{0};
+    bool stopping{false};
+
+    bool try_pop(size_t worker, task & t)
+    {
+        for (size_t i = 0; i < queues.size(); i++)
+        {
+            task_queue & queue = *queues[(worker + i) % queues.size()];
+            std::lock_guard<std::mutex> lock(queue.mutex);
+            if (queue.tasks.empty())
+            {
+                continue;
+            }
+            if (i == 0)
+            {
+                t = std::move(queue.tasks.front());
+                queue.tasks.pop_front();
+            }
+            else
+            {
+                t = std::move(queue.tasks.back());
+                queue.tasks.pop_back();
+            }
+            queued--;
+            return true;
+        }
+        return false;
+    }
+
+    void run(size_t worker)
+    {
+        task t;
+        while (true)
+        {
+            if (try_pop(worker, t))
+            {
+                t(worker);
+                continue;
+            }
+            std::unique_lock<std::mutex> lock(sleep_mutex);
+            wake.wait(lock, [this]() { return stopping || queued > 0; });
+            if (stopping && queued == 0)
+            {
+                return;
+            }
+        }
+    }
+};
+
+} // namespace seqomplexity
@@ -4,122 +4,201 @@
 #include <iostream>
 #include <string>
 #include <vector>
+#include <algorithm>
 #include <cmath>
 
+#include <seqomplexity/composition.hpp>
+#include <seqomplexity/engine.hpp>
+#include <seqomplexity/fasta_reader.hpp>
+#include <seqomplexity/gzip_source.hpp>
+#include <seqomplexity/multi_gc.hpp>
+#include <seqomplexity/multi_track.hpp>
+#include <seqomplexity/ordered_encoding_sink.hpp>
+#include <seqomplexity/record_writer.hpp>
+#include <seqomplexity/sinks.hpp>
 
-bool is_base_GC(char c)
+
+void run_program(size_t wsize, seqomplexity::input_source & input, seqomplexity::score_sink & sink)
 {
-    switch (c)
+    std::string error = seqomplexity::sliding_gc::check_parameters(wsize);
+    if (!error.empty())
     {
-        case 'G':
-        case 'C':
-        case 'g':
-        case 'c':
-            return true;
-        default:
-            return false;
+        std::cerr << error << std::endl;
+        exit(1);
     }
+    seqomplexity::gc_engine engine(wsize);
+    seqomplexity::record_writer writer(engine, sink);
+    seqomplexity::fasta_reader reader(input);
+    reader.read(writer);
 }
 
-size_t GC_of_interval(std::string & sequence, size_t it_start, size_t w)
+// streams several tracks of every record, the GC content of several window
+// sizes or several composition metrics, to one track each while its bases
+// come in
+template <typename engine_t>
+struct multi_track_writer
 {
-    size_t result(0);
-    for (size_t i = it_start; i != it_start+w; ++i)
+    engine_t & engine;
+    seqomplexity::multi_track_output & output;
+    // the scores of every window size are passed on in batches
+    std::vector<std::vector<float>> batches{};
+    std::vector<float *> batch_pointers{};
+    std::vector<size_t> n_written{};
+
+    static constexpr size_t batch_size = size_t(1) << 16;
+
+    void begin_record(std::string const & header)
     {
-        result = result << 1;
-        result += is_base_GC(sequence[i]);
-        result &= ((1 << (w))-1);
+        if (batches.empty())
+        {
+            batches.resize(output.n_tracks(), std::vector<float>(std::max(engine.max_scores(batch_size), engine.max_finish_scores())));
+            for (std::vector<float> & batch : batches)
+            {
+                batch_pointers.push_back(batch.data());
+            }
+            n_written.resize(output.n_tracks());
+        }
+        engine.reset();
+        output.begin_record(seqomplexity::record_name(header));
     }
-    return result;
-}
 
-void run_program(size_t wsize)
-{
-    // test if wsize is odd or 2 < wsize < 21, else throw error
-    if (wsize % 2 == 0 || wsize < 3 || wsize > 20)
+    void bases(char const * seq, size_t n)
     {
-        std::cerr << "wsize must be odd and 2 < wsize < 21" << std::endl;
-        exit(1);
+        while (n > 0)
+        {
+            size_t m = std::min(n, batch_size);
+            engine.push(std::span<char const>(seq, m), batch_pointers, n_written);
+            write_batches();
+            seq += m;
+            n -= m;
+        }
     }
 
-    std::string line;
-    std::string buffer;
-    
-    size_t GCs(0);
-    float result(0.0f);
-    while (std::getline(std::cin, line))
-    {
-        if (line[0] != '>')
+    void end_record()
+    {
+        engine.finish(batch_pointers, n_written);
+        write_batches();
+        output.end_record();
+    }
+
+    void write_batches()
+    {
+        for (size_t j = 0; j < batches.size(); j++)
         {
-            // append the line to the buffer
-            buffer += line;
-            // if the buffer is long enough, compute the hash values
-            if (buffer.size() >= wsize)
-            {
-                // compute GC content of first wsize letters
-                GCs = GC_of_interval(buffer,0,wsize);
-                result = float(std::popcount(GCs)) / float(wsize);
-                // padding of first wsize/2 result values
-                for (size_t i = 0; i < size_t(wsize/2)+1; i++)
-                {
-                    // cout result
-                    std::cout << result << '\n';
-                }
-                // remove the first w letters from the buffer
-                // compute rest of buffer
-                buffer.erase(0,wsize);
-                break;
-            }
+            output.write(j, batches[j].data(), n_written[j]);
         }
+        output.flush();
     }
-    // main loop
-    // while loop through the rest of standard input
-    while (std::getline(std::cin, line) or buffer.size() > 0)
+};
+
+// computes all window sizes in one pass over the input
+void run_program_multi(std::vector<size_t> const & wsizes, seqomplexity::input_source & input, seqomplexity::multi_track_output & output)
+{
+    for (size_t wsize : wsizes)
     {
-        if (line[0] != '>' || buffer.size() > 0)
+        std::string error = seqomplexity::sliding_gc::check_parameters(wsize);
+        if (!error.empty())
         {
-            // if the buffer is not empty, then add the buffer to the front of the line
-            if (buffer.size() > 0) { line = buffer + line; buffer.erase();}
-            // iterate over the line
-            for (char c : line)
-            {
-                // shift the GCs value to the left
-                GCs = GCs << 1;
-                // add the new base to the GCs value
-                GCs += is_base_GC(c);
-                // mask the GCs value to the correct size
-                GCs &= ((1 << (wsize))-1);
-                // compute the result
-                result = float(std::popcount(GCs)) / float(wsize);
-                // cout result
-                std::cout << result << '\n';
-            }
+            std::cerr << error << std::endl;
+            exit(1);
         }
     }
-    // padding of last wsize/2 result values
-    for (size_t i = 0; i < size_t(wsize/2); i++)
+    seqomplexity::multi_gc_engine engine(wsizes);
+    multi_track_writer<seqomplexity::multi_gc_engine> writer{engine, output};
+    seqomplexity::fasta_reader reader(input);
+    reader.read(writer);
+}
+
+// computes all metrics of one window size in one pass over the input
+void run_program_metrics(
+        size_t wsize,
+        std::vector<seqomplexity::composition_metric> const & metrics,
+        seqomplexity::input_source & input,
+        seqomplexity::multi_track_output & output)
+{
+    std::string error = seqomplexity::sliding_gc::check_parameters(wsize);
+    if (!error.empty())
+    {
+        std::cerr << error << std::endl;
+        exit(1);
+    }
+    seqomplexity::composition_engine engine(wsize, metrics);
+    multi_track_writer<seqomplexity::composition_engine> writer{engine, output};
+    seqomplexity::fasta_reader reader(input);
+    reader.read(writer);
+}
+
+// the output of several tracks: text gets a column per track, the other
+// formats a file per track, named after --output with the label of the track
+// in front of the extension, e.g. gc.w100.f32 or gc.cpg_oe.f32
+std::unique_ptr<seqomplexity::multi_track_output> make_multi_output(
+        std::string const & format,
+        std::string const & path,
+        std::vector<std::string> const & labels,
+        std::vector<size_t> const & wsizes,
+        int precision,
+        size_t n_threads)
+{
+    if (format == "text")
+    {
+        return std::make_unique<seqomplexity::multi_track_output>(
+            seqomplexity::open_text_output(path, n_threads), labels.size(), precision);
+    }
+    if (path.empty())
     {
-        // cout result
-        std::cout << result << '\n';
+        throw std::invalid_argument("--format " + format + " with several tracks needs an output file given with --output.");
     }
+    std::vector<std::unique_ptr<seqomplexity::score_sink>> sinks;
+    for (size_t j = 0; j < labels.size(); j++)
+    {
+        sinks.push_back(seqomplexity::make_score_sink(format, seqomplexity::track_path(path, labels[j]), wsizes[j], {}, precision, n_threads));
+    }
+    return std::make_unique<seqomplexity::multi_track_output>(std::move(sinks));
 }
 
 
 struct cmd_arguments
 {
-    size_t wsize{};
+    std::vector<size_t> wsizes{};
+    std::vector<std::string> metrics{};
+    std::string format{"text"};
+    std::filesystem::path output{};
+    int precision{seqomplexity::default_precision};
+    size_t threads{1};
 };
  
 void initialise_parser(sharg::parser & parser, cmd_arguments & args)
 {
     parser.info.author = "VM";
-    parser.info.short_description = "computes the GC content within a window w.";
+    parser.info.short_description = "computes the GC content and other metrics of the base composition within a window w.";
     parser.info.version = "0.0.1";
 
-    parser.add_option(args.wsize, sharg::config{
+    parser.add_option(args.wsizes, sharg::config{
         .short_id = 'w',
         .long_id = "wsize",
-        .description = "window size w must be 2 < w < 21 and odd"});
+        .description = "window size w must be 0 < w < 2^28. several window sizes are computed in one pass, text output gets a tab separated column per window size, the other formats a file per window size named like out.w100.f32."});
+    parser.add_option(args.metrics, sharg::config{
+        .short_id = 'm',
+        .long_id = "metric",
+        .description = "metric of the base composition, may be given several times to compute them in one pass. gc is the GC content, gc_skew (G-C)/(G+C), at_skew (A-T)/(A+T) and cpg_oe the observed over the expected CpG dinucleotides. several metrics need a single window size, text output gets a column per metric, the other formats a file per metric named like out.gc_skew.f32.",
+        .validator = sharg::value_list_validator{seqomplexity::composition_metric_names()}});
+    parser.add_option(args.format, sharg::config{
+        .long_id = "format",
+        .description = "output format. text writes one value per line, bed one line with chrom, start, end and value per base, bedgraph merges runs of equal scores into one such line, bigwig writes an indexed bigWig file with zoom levels for genome browsers, f32 writes a binary float32 track that numpy can memory map, u8 and u16 write a compact quantized track.",
+        .validator = sharg::value_list_validator{seqomplexity::sink_formats()}});
+    parser.add_option(args.output, sharg::config{
+        .short_id = 'o',
+        .long_id = "output",
+        .description = "output file, stdout if not given. needed for the binary formats. text output to a .gz or .bgz file is compressed with bgzip on --threads threads.",
+        .validator = sharg::output_file_validator{sharg::output_file_open_options::open_or_create}});
+    parser.add_option(args.precision, sharg::config{
+        .long_id = "precision",
+        .description = "digits after the decimal point of the text output. without it the values keep 6 significant digits. bedgraph merges scores that are equal at this precision.",
+        .validator = sharg::arithmetic_range_validator{0, seqomplexity::max_precision}});
+    parser.add_option(args.threads, sharg::config{
+        .short_id = 't',
+        .long_id = "threads",
+        .description = "number of threads formatting and compressing the output and decompressing bgzip input."});
 }
  
 int main(int argc, char ** argv)
@@ -140,7 +219,88 @@ int main(int argc, char ** argv)
  
     // parsing was successful !
     // we can start running our program
-    run_program(args.wsize);
+    // every window size and metric is a track of its own, repeated ones would
+    // write the same file twice
+    for (size_t i = 0; i < args.wsizes.size(); i++)
+    {
+        if (std::find(args.wsizes.begin(), args.wsizes.begin() + i, args.wsizes[i]) != args.wsizes.begin() + i)
+        {
+            std::cerr << "The window size " << args.wsizes[i] << " is given more than once." << std::endl;
+            return 1;
+        }
+    }
+    for (size_t i = 0; i < args.metrics.size(); i++)
+    {
+        if (std::find(args.metrics.begin(), args.metrics.begin() + i, args.metrics[i]) != args.metrics.begin() + i)
+        {
+            std::cerr << "The metric " << args.metrics[i] << " is given more than once." << std::endl;
+            return 1;
+        }
+    }
+    try
+    {
+        if (!args.metrics.empty() && args.metrics != std::vector<std::string>{"gc"})
+        {
+            if (args.wsizes.size() != 1)
+            {
+                std::cerr << "--metric needs a single window size." << std::endl;
+                return 1;
+            }
+            if (args.format == "u8" || args.format == "u16")
+            {
+                // skews are negative and cpg_oe exceeds 1
+                std::cerr << "--format " << args.format << " only stores gc, the other metrics need another format." << std::endl;
+                return 1;
+            }
+            std::vector<seqomplexity::composition_metric> metrics;
+            for (std::string const & name : args.metrics)
+            {
+                metrics.push_back(seqomplexity::parse_composition_metric(name));
+            }
+            std::unique_ptr<seqomplexity::multi_track_output> output = make_multi_output(
+                args.format, args.output.string(), args.metrics, std::vector<size_t>(args.metrics.size(), args.wsizes[0]), args.precision, args.threads);
+            std::unique_ptr<seqomplexity::input_source> input = seqomplexity::open_input(STDIN_FILENO, args.threads);
+            run_program_metrics(args.wsizes[0], metrics, *input, *output);
+            output->finish();
+            return 0;
+        }
+        if (args.wsizes.size() > 1)
+        {
+            std::vector<std::string> labels;
+            for (size_t wsize : args.wsizes)
+            {
+                labels.push_back("w" + std::to_string(wsize));
+            }
+            std::unique_ptr<seqomplexity::multi_track_output> output =
+                make_multi_output(args.format, args.output.string(), labels, args.wsizes, args.precision, args.threads);
+            std::unique_ptr<seqomplexity::input_source> input = seqomplexity::open_input(STDIN_FILENO, args.threads);
+            run_program_multi(args.wsizes, *input, *output);
+            output->finish();
+            return 0;
+        }
+        size_t wsize = args.wsizes.empty() ? 0 : args.wsizes[0];
+        std::unique_ptr<seqomplexity::score_sink> sink =
+            seqomplexity::make_score_sink(args.format, args.output.string(), wsize, {}, args.precision, args.threads);
+        // the fasta on stdin may be compressed with gzip or bgzip
+        std::unique_ptr<seqomplexity::input_source> input = seqomplexity::open_input(STDIN_FILENO, args.threads);
+        if (args.threads > 1 && sink->encodes_in_parallel())
+        {
+            // the values are cheap to compute, formatting them is the bottleneck
+            seqomplexity::ordered_encoding_sink parallel_sink(*sink, args.threads);
+            run_program(wsize, *input, parallel_sink);
+            parallel_sink.finish();
+        }
+        else
+        {
+            run_program(wsize, *input, *sink);
+            sink->finish();
+        }
+    }
+    catch (std::exception const & e)
+    {
+        std::cerr << e.what() << std::endl;
+        return 1;
+    }
  
     return 0;
 }
\ No newline at end of file
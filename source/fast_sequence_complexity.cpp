@@ -5,254 +5,1018 @@
 #include <string>
 #include <vector>
 #include <cmath>
+#include <atomic>
+#include <cctype>
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <fstream>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <sstream>
+#include <thread>
 
-size_t hash_dna5(char c)
+#include <seqomplexity/engine.hpp>
+#include <seqomplexity/fai_index.hpp>
+#include <seqomplexity/fasta_reader.hpp>
+#include <seqomplexity/gzip_source.hpp>
+#include <seqomplexity/mapped_file.hpp>
+#include <seqomplexity/mask_sink.hpp>
+#include <seqomplexity/multi_track.hpp>
+#include <seqomplexity/record_writer.hpp>
+#include <seqomplexity/score_archive.hpp>
+#include <seqomplexity/score_cache.hpp>
+#include <seqomplexity/sinks.hpp>
+#include <seqomplexity/sliding_complexity.hpp>
+#include <seqomplexity/spsc_queue.hpp>
+#include <seqomplexity/work_stealing_pool.hpp>
+
+int run_program(
+        size_t wsize,
+        std::vector<uint8_t> kmers,
+        seqomplexity::input_source & input,
+        seqomplexity::score_sink & sink)
 {
-    switch (c)
+    // check w and k, the window state itself is kept on the heap
+    std::string error = seqomplexity::sliding_complexity::check_parameters(wsize, kmers);
+    if (!error.empty())
     {
-        case 'A':
-            return 0;
-        case 'a':
-            return 0;
-        case 'C':
-            return 1;
-        case 'c':
-            return 1;
-        case 'G':
-            return 2;
-        case 'g':
-            return 2;
-        case 'T':
-            return 3;
-        case 't':
-            return 3;
-        default:
-            return 4;
+        std::cerr << error << std::endl;
+        exit(1);
     }
+    seqomplexity::complexity_engine engine(wsize, kmers);
+    seqomplexity::record_writer writer(engine, sink);
+    seqomplexity::fasta_reader reader(input);
+    reader.read(writer);
+    return 0;
 }
 
-// this function recieves a start iterator and an end iterator
-// and returns a hash value for the sequence between the two iterators
-size_t kmer_to_hash(std::string::iterator it_start, std::string::iterator it_end, size_t base=3)
+// streams the complexity and the GC content of every record to two tracks
+// while its bases come in. every base is decoded once through the dna5 rank
+// table and the ranks feed both engines.
+struct fused_writer
 {
-    size_t hashvalue = 0;
-    for (auto it = it_start; it != it_end; it++)
+    seqomplexity::complexity_engine & complexity;
+    seqomplexity::gc_engine & gc;
+    seqomplexity::multi_track_output & output;
+    std::vector<uint8_t> ranks{};
+    std::vector<float> complexity_batch{};
+    std::vector<float> gc_batch{};
+
+    static constexpr size_t batch_size = size_t(1) << 16;
+
+    void begin_record(std::string const & header)
     {
-        hashvalue = (hashvalue << base) + hash_dna5(*it);
+        if (ranks.empty())
+        {
+            ranks.resize(batch_size);
+            complexity_batch.resize(std::max(complexity.max_scores(batch_size), complexity.max_finish_scores()));
+            gc_batch.resize(std::max(gc.max_scores(batch_size), gc.max_finish_scores()));
+        }
+        complexity.reset();
+        gc.reset();
+        output.begin_record(seqomplexity::record_name(header));
     }
-    return hashvalue;
-}
 
-// this function is ran once at initialization
-// it computes the maximum number of unique hashes for each kmer
-// in a given sequence of characters
-std::vector<size_t> sequence_to_kmer_hashes(
-    std::string::iterator it_start,
-    std::string::iterator it_end,
-    size_t k)
+    void bases(char const * seq, size_t n)
+    {
+        while (n > 0)
+        {
+            size_t m = std::min(n, batch_size);
+            for (size_t i = 0; i < m; i++)
+            {
+                ranks[i] = seqomplexity::dna5_rank(seq[i]);
+            }
+            std::span<uint8_t const> block(ranks.data(), m);
+            write(complexity.push_ranks(block, complexity_batch), gc.push_ranks(block, gc_batch));
+            seq += m;
+            n -= m;
+        }
+    }
+
+    void end_record()
+    {
+        write(complexity.finish(complexity_batch), gc.finish(gc_batch));
+        output.end_record();
+    }
+
+    void write(size_t n_complexity, size_t n_gc)
+    {
+        output.write(0, complexity_batch.data(), n_complexity);
+        output.write(1, gc_batch.data(), n_gc);
+        output.flush();
+    }
+};
+
+// computes the complexity and the GC content in one pass over the input
+int run_program_fused(
+        size_t wsize,
+        std::vector<uint8_t> kmers,
+        size_t gc_wsize,
+        seqomplexity::input_source & input,
+        seqomplexity::multi_track_output & output)
 {
-    // loop over the sequence and calculate the hash value for each kmer
-    std::vector<size_t> hashvalues{};
-    for (auto it = it_start; it != it_end-k+1; it++)
+    std::string error = seqomplexity::sliding_complexity::check_parameters(wsize, kmers);
+    if (error.empty())
     {
-        hashvalues.push_back(kmer_to_hash(it,it+k));
+        error = seqomplexity::sliding_gc::check_parameters(gc_wsize);
     }
-    return hashvalues;
+    if (!error.empty())
+    {
+        std::cerr << error << std::endl;
+        exit(1);
+    }
+    seqomplexity::complexity_engine complexity(wsize, kmers);
+    seqomplexity::gc_engine gc(gc_wsize);
+    fused_writer writer{complexity, gc, output};
+    seqomplexity::fasta_reader reader(input);
+    reader.read(writer);
+    return 0;
 }
 
-size_t extend_hash(size_t kmer_hash, size_t letter_dna5 , size_t k, size_t base=3)
+// the output of the fused mode: text gets a complexity and a GC column, the
+// other formats a file per track, named after --output with complexity or gc
+// in front of the extension
+std::unique_ptr<seqomplexity::multi_track_output> make_fused_output(
+        std::string const & format,
+        std::string const & path,
+        size_t wsize,
+        std::vector<uint8_t> const & kmers,
+        size_t gc_wsize,
+        int precision,
+        size_t n_threads)
 {
-    return ((kmer_hash << base) + letter_dna5) & ((1 << (k*base))-1);
+    if (format == "text")
+    {
+        return std::make_unique<seqomplexity::multi_track_output>(seqomplexity::open_text_output(path, n_threads), 2, precision);
+    }
+    if (path.empty())
+    {
+        throw std::invalid_argument("--format " + format + " with --gc-wsize needs an output file given with --output.");
+    }
+    std::vector<std::unique_ptr<seqomplexity::score_sink>> sinks;
+    sinks.push_back(seqomplexity::make_score_sink(format, seqomplexity::track_path(path, "complexity"), wsize, kmers, precision, n_threads));
+    sinks.push_back(seqomplexity::make_score_sink(format, seqomplexity::track_path(path, "gc"), gc_wsize, {}, precision, n_threads));
+    return std::make_unique<seqomplexity::multi_track_output>(std::move(sinks));
 }
 
+// bases per line of the soft masked fasta
+constexpr size_t fasta_line_width = 60;
 
-// this function computes the product of the element wise division of two arrays.
-// the arrays must have the same size. The result is a float.
-float product(size_t *a, size_t *b, size_t size)
+// streams the complexity of every record to a mask_sink and writes the bases
+// to a fasta with the masked intervals in lowercase. the bases are held back
+// until the sink decided whether they are masked, which is at most a batch of
+// scores, half a window and the interval that is still open.
+struct masked_fasta_writer
 {
-    float result(1.0);
-    for (size_t i = 0; i < size; i++)
+    seqomplexity::record_writer<seqomplexity::complexity_engine> & scores;
+    seqomplexity::mask_sink & mask;
+    seqomplexity::byte_output & fasta;
+    // the bases of the current record from position pending_start on
+    std::string pending{};
+    size_t pending_start{0};
+    size_t line_fill{0};
+    std::string text{};
+
+    void begin_record(std::string const & header)
     {
-        result *= (float(a[i]) / float(b[i]));
+        scores.begin_record(header);
+        pending.clear();
+        pending_start = 0;
+        line_fill = 0;
+        fasta.write(">" + header + "\n");
     }
-    return result;
-}
 
-size_t count_equal_kmer_hashes(size_t * kmer_hashes, size_t start, size_t end, size_t value)
-{
-    size_t count(0);
-    for (size_t i = start; i < end; i++)
+    void bases(char const * seq, size_t n)
+    {
+        pending.append(seq, n);
+        scores.bases(seq, n);
+        write_decided();
+    }
+
+    void end_record()
     {
-        if (kmer_hashes[i] == value)
+        scores.end_record();
+        write_decided();
+        if (line_fill > 0)
         {
-            count++;
+            fasta.write("\n", 1);
         }
     }
-    return count;
-}
 
-size_t calc_position(size_t w, size_t k, size_t i, size_t index)
+    void write_decided()
+    {
+        for (auto [start, end] : mask.take_intervals())
+        {
+            for (size_t p = start; p < end; p++)
+            {
+                pending[p - pending_start] = char(std::tolower(static_cast<unsigned char>(pending[p - pending_start])));
+            }
+        }
+        // the scores lag behind the bases, after end_record all bases are decided
+        size_t decided = mask.decided();
+        size_t n = decided - pending_start;
+        text.clear();
+        for (size_t i = 0; i < n;)
+        {
+            size_t m = std::min(n - i, fasta_line_width - line_fill);
+            text.append(pending, i, m);
+            i += m;
+            line_fill += m;
+            if (line_fill == fasta_line_width)
+            {
+                text += '\n';
+                line_fill = 0;
+            }
+        }
+        fasta.write(text);
+        pending.erase(0, n);
+        pending_start = decided;
+    }
+};
+
+// writes the low complexity intervals as BED to the sink and the input as a
+// soft masked fasta
+int run_program_masked(
+        size_t wsize,
+        std::vector<uint8_t> kmers,
+        seqomplexity::input_source & input,
+        seqomplexity::mask_sink & mask,
+        seqomplexity::byte_output & fasta)
 {
-    size_t alpha = w-k+1;
-    return index+((alpha+i-1)%alpha);
+    std::string error = seqomplexity::sliding_complexity::check_parameters(wsize, kmers);
+    if (!error.empty())
+    {
+        std::cerr << error << std::endl;
+        exit(1);
+    }
+    seqomplexity::complexity_engine engine(wsize, kmers);
+    seqomplexity::record_writer scores(engine, mask);
+    mask.keep_intervals();
+    masked_fasta_writer writer{scores, mask, fasta};
+    seqomplexity::fasta_reader reader(input);
+    reader.read(writer);
+    return 0;
 }
-size_t calc_last_position(size_t w, size_t k, size_t i, size_t index)
+
+// same output as run_program, but the scores of every record are looked up in
+// a score cache first and stored there if they were computed. the records are
+// collected whole, as the key depends on all their bases.
+int run_program_cached(
+        size_t wsize,
+        std::vector<uint8_t> kmers,
+        seqomplexity::score_cache & cache,
+        seqomplexity::input_source & input,
+        seqomplexity::score_sink & sink)
 {
-    size_t alpha = w-k+1;
-    return index+((alpha+i-2)%alpha);
+    std::string error = seqomplexity::sliding_complexity::check_parameters(wsize, kmers);
+    if (!error.empty())
+    {
+        std::cerr << error << std::endl;
+        exit(1);
+    }
+    seqomplexity::complexity_engine engine(wsize, kmers);
+
+    struct cached_writer
+    {
+        seqomplexity::complexity_engine & engine;
+        seqomplexity::score_cache & cache;
+        seqomplexity::score_sink & sink;
+        std::string sequence{};
+        std::vector<float> scores{};
+
+        void begin_record(std::string const & header)
+        {
+            sink.begin_record(seqomplexity::record_name(header));
+            sequence.clear();
+        }
+
+        void bases(char const * seq, size_t n)
+        {
+            sequence.append(seq, n);
+        }
+
+        void end_record()
+        {
+            seqomplexity::record_key key = cache.key(sequence.data(), sequence.size());
+            if (std::unique_ptr<seqomplexity::mapped_file> cached = cache.load(key, sequence.size()))
+            {
+                sink.write(seqomplexity::score_cache::scores(*cached), sequence.size());
+                sink.end_record();
+                return;
+            }
+            scores.resize(engine.max_scores(sequence.size()) + engine.max_finish_scores());
+            size_t n = engine.push(sequence, scores);
+            n += engine.finish(std::span<float>(scores).subspan(n));
+            scores.resize(n);
+            sink.write(scores.data(), scores.size());
+            sink.end_record();
+            cache.store(key, scores);
+        }
+    };
+    cached_writer writer{engine, cache, sink};
+    seqomplexity::fasta_reader reader(input);
+    reader.read(writer);
+    return 0;
 }
 
-int run_program(
+// a batch passed between the stages of the pipelined mode
+struct pipeline_message
+{
+    enum kind_t
+    {
+        begin_record,
+        scores,
+        end_record
+    };
+
+    kind_t kind{scores};
+    // the header of a record, its bases from the decoder or their encoded scores
+    std::string text{};
+    std::vector<float> values{};
+};
+
+// thrown in the decoder when the next stage cancelled its queue
+struct pipeline_cancelled
+{};
+
+// same output as run_program, with the input decoding, the scoring, the
+// formatting and the writing on four threads connected by bounded queues of
+// batches, so the run takes about as long as its slowest stage. every queue
+// holds at most depth batches and the batches are sized to keep all queues
+// below memory_limit bytes. sinks that do not encode in parallel format in
+// the writer, their format stage only passes the scores on.
+int run_program_pipelined(
         size_t wsize,
-        std::vector<uint8_t> kmers)
+        std::vector<uint8_t> kmers,
+        size_t depth,
+        size_t memory_limit,
+        seqomplexity::input_source & input,
+        seqomplexity::score_sink & sink)
 {
-    // check if the window size is larger than the maximum kmer size
-    if (wsize < *std::max_element(kmers.begin(), kmers.end()))
+    std::string error = seqomplexity::sliding_complexity::check_parameters(wsize, kmers);
+    if (!error.empty())
     {
-        std::cerr << "The window size must be larger than the maximum kmer size." << std::endl;
+        std::cerr << error << std::endl;
         exit(1);
     }
-    // check if wsize is odd and 2 < wsize < 21.
-    if (wsize % 2 == 0 || wsize < 2 || wsize > 21)
+    depth = std::max(depth, size_t(1));
+    // a base takes a byte in the first queue, a float in the second and at
+    // most a float or the text of its score in the third
+    size_t batch_size = std::clamp(memory_limit / (depth * (1 + 4 + seqomplexity::max_score_chars)),
+                                   size_t(1) << 12, size_t(1) << 20);
+    seqomplexity::spsc_queue<pipeline_message> decoded(depth);
+    seqomplexity::spsc_queue<pipeline_message> scored(depth);
+    seqomplexity::spsc_queue<pipeline_message> formatted(depth);
+    // the first error of every stage, rethrown after all stages stopped
+    std::exception_ptr errors[4];
+
+    // collects the bases of the reader into batches
+    struct decode_handler
     {
-        std::cerr << "The window size must be an odd number between 2 and 21." << std::endl;
-        exit(1);
+        seqomplexity::spsc_queue<pipeline_message> & out;
+        size_t batch_size;
+        pipeline_message batch{};
+
+        void begin_record(std::string const & header)
+        {
+            send(pipeline_message{pipeline_message::begin_record, header});
+        }
+
+        void bases(char const * seq, size_t n)
+        {
+            batch.text.append(seq, n);
+            if (batch.text.size() >= batch_size)
+            {
+                send(std::move(batch));
+                batch = pipeline_message{};
+                batch.text.reserve(batch_size + 4096);
+            }
+        }
+
+        void end_record()
+        {
+            if (!batch.text.empty())
+            {
+                send(std::move(batch));
+                batch = pipeline_message{};
+            }
+            send(pipeline_message{pipeline_message::end_record});
+        }
+
+        void send(pipeline_message message)
+        {
+            if (!out.push(std::move(message)))
+            {
+                throw pipeline_cancelled{};
+            }
+        }
+    };
+    std::thread decoder([&]()
+    {
+        try
+        {
+            decode_handler handler{decoded, batch_size};
+            seqomplexity::fasta_reader reader(input);
+            reader.read(handler);
+        }
+        catch (pipeline_cancelled const &)
+        {}
+        catch (...)
+        {
+            errors[0] = std::current_exception();
+        }
+        decoded.close();
+    });
+
+    std::thread scorer([&]()
+    {
+        try
+        {
+            seqomplexity::complexity_engine engine(wsize, kmers);
+            pipeline_message message;
+            while (decoded.pop(message))
+            {
+                if (message.kind == pipeline_message::scores)
+                {
+                    message.values.resize(engine.max_scores(message.text.size()));
+                    message.values.resize(engine.push(message.text, message.values));
+                    message.text = std::string();
+                }
+                else if (message.kind == pipeline_message::end_record)
+                {
+                    message.values.resize(engine.max_finish_scores());
+                    message.values.resize(engine.finish(message.values));
+                }
+                else
+                {
+                    engine.reset();
+                }
+                if (!scored.push(std::move(message)))
+                {
+                    break;
+                }
+            }
+        }
+        catch (...)
+        {
+            errors[1] = std::current_exception();
+        }
+        decoded.cancel();
+        scored.close();
+    });
+
+    std::thread formatter([&]()
+    {
+        try
+        {
+            pipeline_message message;
+            while (scored.pop(message))
+            {
+                if (message.kind != pipeline_message::begin_record && sink.encodes_in_parallel())
+                {
+                    sink.encode(message.values.data(), message.values.size(), message.text);
+                    message.values = std::vector<float>();
+                }
+                if (!formatted.push(std::move(message)))
+                {
+                    break;
+                }
+            }
+        }
+        catch (...)
+        {
+            errors[2] = std::current_exception();
+        }
+        scored.cancel();
+        formatted.close();
+    });
+
+    try
+    {
+        pipeline_message message;
+        while (formatted.pop(message))
+        {
+            if (message.kind == pipeline_message::begin_record)
+            {
+                sink.begin_record(seqomplexity::record_name(message.text));
+                continue;
+            }
+            if (sink.encodes_in_parallel())
+            {
+                sink.write_encoded(message.text);
+            }
+            else
+            {
+                sink.write(message.values.data(), message.values.size());
+            }
+            if (message.kind == pipeline_message::end_record)
+            {
+                sink.end_record();
+            }
+        }
     }
-    size_t nk(kmers.size());
-    size_t kmers_array[nk] = {0};
-    std::copy(kmers.begin(), kmers.end(), kmers_array);
-    size_t MAX_UNIQUE_HASHES[nk];
-    // compute the maximum number of unique hashes for each k
-    for (size_t i = 0; i < nk; i++){
-        MAX_UNIQUE_HASHES[i] = std::min(wsize-kmers_array[i]+1,size_t(pow(4,kmers_array[i]))+1);
+    catch (...)
+    {
+        errors[3] = std::current_exception();
     }
-    std::string line;
-    std::string buffer;
-    // replace the vector of vectors with an array. every array according to a kmer is saved in
-    // a certain interval on the array. this way, we can use the same array for all kmers.
-    size_t kmer_hashes_index[nk] = {0};
-    for (size_t i = 1; i < nk; i++)
-    {
-        kmer_hashes_index[i] = kmer_hashes_index[i-1]
-            + wsize - kmers_array[i-1]+1;
-    }
-    size_t kmer_hashes_size = kmer_hashes_index[nk-1]+wsize-kmers_array[nk-1]+1;
-    size_t kmer_hashes[kmer_hashes_size]= {0};
-    // std::vector<std::vector<size_t>> kmer_hashes(kmers.size());
-    size_t current_unique_n_hashes[nk] = {0};
-    // first, fill the buffer and compute the initial hash values
-    while (std::getline(std::cin, line))
-    {
-        if (line[0] != '>')
-        {
-            // append the line to the buffer
-            buffer += line;
-            // if the buffer is long enough, compute the hash values
-            if (buffer.size() >= wsize)
+    formatted.cancel();
+    decoder.join();
+    scorer.join();
+    formatter.join();
+    for (std::exception_ptr const & e : errors)
+    {
+        if (e)
+        {
+            std::rethrow_exception(e);
+        }
+    }
+    return 0;
+}
+
+// number of windows scored by one task in the parallel mode
+constexpr size_t windows_per_task = size_t(1) << 20;
+
+// an entry in the reorder buffer of the parallel mode: the start of a record,
+// a chunk of its windows or its end. records are cut into chunks of
+// windows_per_task windows while their bases come in, consecutive chunks of a
+// record overlap by wsize - 1 bases.
+struct chunk_result
+{
+    enum kind_t
+    {
+        begin_record,
+        windows,
+        end_record
+    };
+
+    kind_t kind{windows};
+    // the name of the record for begin_record
+    std::string name{};
+    std::string bases{};
+    // the bases held by the chunk until it is written
+    size_t n_bases{0};
+    // the scores of a chunk, or their encoding if the sink encodes in parallel
+    std::vector<float> scores{};
+    std::string encoded{};
+    float first_score{0.0f};
+    float last_score{0.0f};
+    // the number of bases of the record for end_record
+    size_t record_length{0};
+    std::atomic<bool> done{true};
+};
+
+// scores every window of a chunk
+void score_chunk(
+        seqomplexity::sliding_complexity & complexity,
+        seqomplexity::score_sink const & sink,
+        chunk_result & chunk)
+{
+    size_t n_windows = chunk.bases.size() - complexity.window_size() + 1;
+    chunk.scores.resize(n_windows);
+    complexity.score_windows(chunk.bases.data(), n_windows, chunk.scores.data());
+    chunk.first_score = chunk.scores.front();
+    chunk.last_score = chunk.scores.back();
+    chunk.bases = std::string();
+    if (sink.encodes_in_parallel())
+    {
+        sink.encode(chunk.scores.data(), chunk.scores.size(), chunk.encoded);
+        chunk.scores = std::vector<float>();
+    }
+}
+
+// writes the finished entries in the same layout as run_program
+struct chunk_writer
+{
+    size_t wsize;
+    seqomplexity::score_sink & sink;
+    bool first_chunk{true};
+    float last_score{0.0f};
+
+    void write(chunk_result const & entry)
+    {
+        switch (entry.kind)
+        {
+            case chunk_result::begin_record:
+                sink.begin_record(entry.name);
+                first_chunk = true;
+                break;
+            case chunk_result::windows:
+                if (first_chunk)
+                {
+                    sink.write_repeated(entry.first_score, size_t(wsize/2));
+                    first_chunk = false;
+                }
+                if (sink.encodes_in_parallel())
+                {
+                    sink.write_encoded(entry.encoded);
+                }
+                else
+                {
+                    sink.write(entry.scores.data(), entry.scores.size());
+                }
+                last_score = entry.last_score;
+                break;
+            case chunk_result::end_record:
+                if (entry.record_length < wsize)
+                {
+                    sink.write_repeated(0.0f, entry.record_length);
+                }
+                else
+                {
+                    sink.write_repeated(last_score, size_t((wsize-1)/2));
+                }
+                sink.end_record();
+                break;
+        }
+    }
+};
+
+// same output as run_program, but the windows are scored in parallel on a
+// work stealing pool. the records are cut into chunks of windows_per_task
+// windows while their bases come in, so a chromosome is never held whole.
+// finished chunks wait in a reorder buffer until all entries before them have
+// been written, the bases in the buffer are bounded by max_bases_in_flight.
+// an exception in a task is rethrown here once the pool has drained.
+int run_program_parallel(
+        size_t wsize,
+        std::vector<uint8_t> kmers,
+        size_t n_threads,
+        seqomplexity::input_source & input,
+        seqomplexity::score_sink & sink)
+{
+    std::string error = seqomplexity::sliding_complexity::check_parameters(wsize, kmers);
+    if (!error.empty())
+    {
+        std::cerr << error << std::endl;
+        exit(1);
+    }
+    std::vector<seqomplexity::sliding_complexity> workers(n_threads, seqomplexity::sliding_complexity(wsize, kmers));
+    size_t chunk_bases = windows_per_task + wsize - 1;
+    size_t max_bases_in_flight = 4 * n_threads * chunk_bases;
+    size_t bases_in_flight(0);
+    std::deque<std::unique_ptr<chunk_result>> reorder_buffer;
+    chunk_writer writer{wsize, sink};
+    std::mutex done_mutex;
+    std::condition_variable done;
+    std::exception_ptr failure;
+    {
+        seqomplexity::work_stealing_pool pool(n_threads);
+
+        // writes the finished entries at the front of the buffer. with wait
+        // set it blocks until the first entry is finished.
+        auto write_finished = [&](bool wait)
+        {
+            while (!reorder_buffer.empty())
             {
-                for (size_t ki = 0; ki < nk; ki++)
+                chunk_result & front = *reorder_buffer.front();
                 {
-                    std::vector<size_t> kmer_hashes_init = sequence_to_kmer_hashes(buffer.begin(),buffer.begin()+wsize,kmers_array[ki]);
-                    // i is the index of the kmer in the window - offset
-                    // the offset is given in the index
-                    // std::cout << "calc first hashes with k = " << kmers_array[ki] << std::endl;
-                    for (size_t i = 0; i < wsize-kmers_array[ki]+1; i++)
+                    std::unique_lock<std::mutex> lock(done_mutex);
+                    if (wait)
+                    {
+                        done.wait(lock, [&]() { return front.done.load() || failure; });
+                    }
+                    if (failure)
+                    {
+                        // stops reading, the pool drains before the error is rethrown
+                        throw std::runtime_error("a task of the parallel mode failed.");
+                    }
+                    if (!front.done)
                     {
-                        kmer_hashes[kmer_hashes_index[ki] + i] = kmer_hashes_init[i];
-                        // DEBUG START
-                        // print kmer_hashes from 0 to kmer_hashes_index[nk-1]+kmers_array[nk-1]
-                        // for (size_t i = 0; i < kmer_hashes_size; i++)
-                        // {
-                        //     std::cout << kmer_hashes[i] << " ";
-                        // }
-                        // std::cout << std::endl;
-                        // DEBUG END
+                        return;
                     }
                 }
-                // starting unique k-mer counts
-                for (size_t ki = 0; ki < nk; ki++)
+                writer.write(front);
+                bases_in_flight -= front.n_bases;
+                reorder_buffer.pop_front();
+                wait = false;
+            }
+        };
+        auto submit = [&](std::unique_ptr<chunk_result> entry)
+        {
+            chunk_result & chunk = *entry;
+            bases_in_flight += chunk.n_bases;
+            reorder_buffer.push_back(std::move(entry));
+            if (chunk.kind == chunk_result::windows)
+            {
+                chunk.done = false;
+                pool.submit([&](size_t worker)
+                {
+                    try
+                    {
+                        score_chunk(workers[worker], sink, chunk);
+                    }
+                    catch (...)
+                    {
+                        std::lock_guard<std::mutex> lock(done_mutex);
+                        if (!failure)
+                        {
+                            failure = std::current_exception();
+                        }
+                    }
+                    std::lock_guard<std::mutex> lock(done_mutex);
+                    chunk.done = true;
+                    done.notify_all();
+                });
+            }
+            write_finished(false);
+            while (bases_in_flight > max_bases_in_flight)
+            {
+                write_finished(true);
+            }
+        };
+
+        // cuts the bases of every record into overlapping chunks
+        struct chunk_collector
+        {
+            std::function<void(std::unique_ptr<chunk_result>)> submit;
+            size_t wsize;
+            size_t chunk_bases;
+            std::unique_ptr<chunk_result> chunk{};
+            size_t record_length{0};
+
+            void begin_record(std::string const & header)
+            {
+                auto entry = std::make_unique<chunk_result>();
+                entry->kind = chunk_result::begin_record;
+                entry->name = seqomplexity::record_name(header);
+                submit(std::move(entry));
+                chunk = std::make_unique<chunk_result>();
+                record_length = 0;
+            }
+
+            void bases(char const * seq, size_t n)
+            {
+                record_length += n;
+                while (n > 0)
                 {
-                    // std::cout << "count unique k-mers" << std::endl;
-                    size_t interval_start = kmer_hashes_index[ki];
-                    size_t interval_end = interval_start + wsize - kmers_array[ki]+1;
-                    // copy the interval of kmer_hashes to a set and count the elements
-                    current_unique_n_hashes[ki] = std::set<size_t>(
-                        kmer_hashes+interval_start,
-                        kmer_hashes+interval_end).size();
+                    size_t m = std::min(n, chunk_bases - chunk->bases.size());
+                    chunk->bases.append(seq, m);
+                    seq += m;
+                    n -= m;
+                    if (chunk->bases.size() == chunk_bases)
+                    {
+                        // the next chunk starts with the last wsize - 1 bases
+                        auto next = std::make_unique<chunk_result>();
+                        next->bases.reserve(chunk_bases);
+                        next->bases.assign(chunk->bases, chunk_bases - (wsize - 1), wsize - 1);
+                        submit_chunk();
+                        chunk = std::move(next);
+                    }
                 }
-                // padding to fill the first half of the window
-                for (size_t i = 0; i < size_t(wsize/2)+1; i++)
+            }
+
+            void end_record()
+            {
+                if (chunk->bases.size() >= wsize)
                 {
-                    // std::cout << i << '\n';
-                    std::cout << product(current_unique_n_hashes,MAX_UNIQUE_HASHES,nk) << '\n';
+                    submit_chunk();
                 }
-                // remove the first w letters from the buffer
-                buffer.erase(0,wsize);
-                // print buffer with cout
-                break;
+                auto entry = std::make_unique<chunk_result>();
+                entry->kind = chunk_result::end_record;
+                entry->record_length = record_length;
+                submit(std::move(entry));
+            }
+
+            void submit_chunk()
+            {
+                chunk->n_bases = chunk->bases.size();
+                submit(std::move(chunk));
             }
+        };
+        chunk_collector collector{submit, wsize, chunk_bases};
+        try
+        {
+            seqomplexity::fasta_reader reader(input);
+            reader.read(collector);
+            while (!reorder_buffer.empty())
+            {
+                write_finished(true);
+            }
+        }
+        catch (...)
+        {
+            std::unique_lock<std::mutex> lock(done_mutex);
+            if (!failure)
+            {
+                throw;
+            }
+        }
+    }
+    if (failure)
+    {
+        std::rethrow_exception(failure);
+    }
+    return 0;
+}
+
+// one line of a BED file of target regions
+struct region
+{
+    std::string chrom{};
+    size_t start{0};
+    size_t end{0};
+};
+
+std::vector<region> read_regions(std::filesystem::path const & path)
+{
+    std::ifstream in(path);
+    if (!in)
+    {
+        std::cerr << "Could not open the regions file " << path << "." << std::endl;
+        exit(1);
+    }
+    std::vector<region> regions;
+    std::string line;
+    while (std::getline(in, line))
+    {
+        if (line.empty() || line[0] == '#' || line.rfind("track", 0) == 0 || line.rfind("browser", 0) == 0)
+        {
+            continue;
+        }
+        std::istringstream fields(line);
+        region r;
+        if (!(fields >> r.chrom >> r.start >> r.end) || r.start > r.end)
+        {
+            std::cerr << "Malformed line in the regions file: " << line << std::endl;
+            exit(1);
+        }
+        regions.push_back(r);
+    }
+    return regions;
+}
+
+// scores the bases [start, end) of a region exactly like a scan over the whole
+// record: position p gets the window starting at p - wsize/2, clamped to the
+// record. only the windows of the region and its w/2 flanks are computed.
+void score_region(
+        seqomplexity::sliding_complexity & complexity,
+        std::vector<float> & scores,
+        std::string & bases,
+        seqomplexity::mapped_file const & fasta,
+        seqomplexity::fai_record const & record,
+        region const & r,
+        std::vector<float> & values)
+{
+    size_t wsize = complexity.window_size();
+    values.clear();
+    if (record.length < wsize)
+    {
+        values.resize(r.end - r.start, 0.0f);
+        return;
+    }
+    auto window_of = [&](size_t p)
+    {
+        return std::min(p < wsize/2 ? 0 : p - wsize/2, record.length - wsize);
+    };
+    if (r.start < r.end)
+    {
+        size_t first = window_of(r.start);
+        size_t last = window_of(r.end - 1);
+        seqomplexity::fai_index::fetch(fasta.data(), fasta.size(), record, first, last + wsize, bases);
+        scores.resize(last - first + 1);
+        complexity.score_windows(bases.data(), scores.size(), scores.data());
+        values.reserve(r.end - r.start);
+        for (size_t p = r.start; p < r.end; p++)
+        {
+            values.push_back(scores[window_of(p) - first]);
         }
     }
-    // main loop
-    // while loop through the rest of standard input
+}
 
-    size_t i(0);
-    while (std::getline(std::cin, line) || buffer.size() > 0)
+// scores only the regions of a BED file. the FASTA is memory mapped and the
+// regions are fetched through its .fai index, which is built if it is missing.
+// the regions are scored in parallel and written in the order of the BED file,
+// every region as a record named chrom:start-end.
+int run_program_regions(
+        std::filesystem::path const & input,
+        std::filesystem::path const & regions_path,
+        size_t wsize,
+        std::vector<uint8_t> kmers,
+        size_t n_threads,
+        seqomplexity::score_sink & sink)
+{
+    std::string error = seqomplexity::sliding_complexity::check_parameters(wsize, kmers);
+    if (!error.empty())
     {
-        if (line[0] != '>' || buffer.size() > 0)
+        std::cerr << error << std::endl;
+        exit(1);
+    }
+    n_threads = std::max(n_threads, size_t(1));
+    std::vector<region> regions = read_regions(regions_path);
+    std::unique_ptr<seqomplexity::mapped_file> fasta;
+    seqomplexity::fai_index index;
+    try
+    {
+        fasta = std::make_unique<seqomplexity::mapped_file>(input.string());
+        if (fasta->size() >= 2 && (unsigned char)(fasta->data()[0]) == 0x1f && (unsigned char)(fasta->data()[1]) == 0x8b)
         {
-            // if the buffer is not empty, then add the buffer to the front of the line
-            if (buffer.size() > 0) { line = buffer + line; buffer.erase();}
-            // iterate over the line
-            for (char c : line)
+            std::cerr << "--regions needs an uncompressed fasta file, " << input << " is compressed." << std::endl;
+            exit(1);
+        }
+        index = seqomplexity::fai_index::load_or_build(input.string(), *fasta);
+    }
+    catch (std::exception const & e)
+    {
+        std::cerr << e.what() << std::endl;
+        exit(1);
+    }
+    std::vector<seqomplexity::fai_record const *> records;
+    for (region const & r : regions)
+    {
+        seqomplexity::fai_record const * record = index.find(r.chrom);
+        if (record == nullptr || r.end > record->length)
+        {
+            std::cerr << "The region " << r.chrom << ':' << r.start << '-' << r.end << " is not part of " << input << "." << std::endl;
+            exit(1);
+        }
+        records.push_back(record);
+    }
+
+    std::vector<seqomplexity::sliding_complexity> workers(n_threads, seqomplexity::sliding_complexity(wsize, kmers));
+    std::vector<std::vector<float>> worker_scores(n_threads);
+    std::vector<std::string> worker_bases(n_threads);
+    std::vector<std::vector<float>> values(regions.size());
+    std::vector<std::string> encoded(regions.size());
+    std::unique_ptr<std::atomic<bool>[]> finished(new std::atomic<bool>[regions.size()]);
+    std::mutex done_mutex;
+    std::condition_variable done;
+    std::atomic<bool> failed(false);
+    std::string failure;
+    seqomplexity::work_stealing_pool pool(n_threads);
+    for (size_t i = 0; i < regions.size(); i++)
+    {
+        finished[i] = false;
+        pool.submit([&, i](size_t worker)
+        {
+            try
             {
-                // DEBUG START
-                // if (c == '\n') { std::cout << "found line end.\n"; continue; }
-                // DEBUG END
-                i++;
-                size_t h = hash_dna5(c);
-                for (size_t j = 0; j < nk; j++)
+                score_region(workers[worker], worker_scores[worker], worker_bases[worker], *fasta, *records[i], regions[i], values[i]);
+                if (sink.encodes_in_parallel())
                 {
-                    size_t k = kmers_array[j];
-                    size_t k_base_length(wsize-k+1);
-                    size_t position = calc_position(wsize,k,i,kmer_hashes_index[j]);
-                    size_t last_position=calc_last_position(wsize,k,i,kmer_hashes_index[j]);
-                    size_t old_hash = kmer_hashes[last_position];
-                    bool last_hash_unique = count_equal_kmer_hashes(kmer_hashes,kmer_hashes_index[j],kmer_hashes_index[j]+wsize-k+1,kmer_hashes[position]) == 1;
-                    current_unique_n_hashes[j] -= size_t(last_hash_unique);
-                    size_t new_hash = extend_hash(old_hash,h,k);
-                    kmer_hashes[position]=new_hash;
-                    // update count of unique elements in k-mers
-                    bool new_hash_unique = count_equal_kmer_hashes(kmer_hashes,kmer_hashes_index[j],kmer_hashes_index[j]+wsize-k+1,new_hash) == 1;
-                    current_unique_n_hashes[j] += int(new_hash_unique);
-                    // for (size_t hashval : kmer_hashes[j])
-                    // {
-                    //     std::cout << hashval << '\t';
-                    // }
-                    // std::cout << '\n';
-                    // std::cout << "position: " << position << " last position: " << last_position << " kmer: " << k << " old hash: " << old_hash << " new hash: " << new_hash << " new letter: " << seqan3::to_char(sequence[i+wsize-1]) << '\n';
+                    sink.encode(values[i].data(), values[i].size(), encoded[i]);
+                    values[i] = std::vector<float>();
                 }
-            std::cout << product(current_unique_n_hashes,MAX_UNIQUE_HASHES,nk) << '\n';
             }
-            buffer.clear();
-        // std::cout << i+size_t(wsize/2) << '\n';
-        // print_current_unique_hashes(current_unique_n_hashes);
-        //results[i] = product(current_unique_n_hashes,MAX_UNIQUE_HASHES);  
-        }
+            catch (std::exception const & e)
+            {
+                std::lock_guard<std::mutex> lock(done_mutex);
+                failure = e.what();
+                failed = true;
+            }
+            std::lock_guard<std::mutex> lock(done_mutex);
+            finished[i] = true;
+            done.notify_all();
+        });
     }
-    // print the last half of the window
-    for (size_t i = 0; i < size_t(wsize/2); i++)
+    for (size_t i = 0; i < regions.size(); i++)
     {
-        std::cout << product(current_unique_n_hashes,MAX_UNIQUE_HASHES,nk) << '\n';
+        {
+            std::unique_lock<std::mutex> lock(done_mutex);
+            done.wait(lock, [&]() { return finished[i].load(); });
+            if (failed)
+            {
+                std::cerr << failure << std::endl;
+                exit(1);
+            }
+        }
+        region const & r = regions[i];
+        sink.begin_region(r.chrom, r.start, r.end);
+        if (sink.encodes_in_parallel())
+        {
+            sink.write_encoded(encoded[i]);
+            encoded[i] = std::string();
+        }
+        else
+        {
+            sink.write(values[i].data(), values[i].size());
+            values[i] = std::vector<float>();
+        }
+        sink.end_record();
     }
     return 0;
 }
 
-
 struct cmd_arguments
 {
     size_t wsize{};
     std::vector<uint8_t> kmers{};
+    size_t threads{1};
+    std::filesystem::path input{};
+    std::filesystem::path regions{};
+    std::string format{"text"};
+    std::filesystem::path output{};
+    int precision{seqomplexity::default_precision};
+    size_t gc_wsize{0};
+    float mask_below{0.0f};
+    size_t mask_min_length{1};
+    size_t mask_merge_gap{0};
+    std::filesystem::path masked_fasta{};
+    std::filesystem::path cache_dir{};
+    bool pipeline{false};
+    size_t queue_depth{4};
+    size_t pipeline_memory{256};
 };
  
 void initialise_parser(sharg::parser & parser, cmd_arguments & args)
@@ -264,15 +1028,294 @@ void initialise_parser(sharg::parser & parser, cmd_arguments & args)
     parser.add_option(args.wsize, sharg::config{
         .short_id = 'w',
         .long_id = "wsize",
-        .description = "window size w must be 2 < w < 21."});
+        .description = "window size w must be 1 < w < 2^28."});
     parser.add_option(args.kmers, sharg::config{
         .short_id = 'k',
         .long_id = "kmers",
-        .description = "any k must be 1 < k < w+1."});
+        .description = "any k must be 0 < k < 32 and k < w+1."});
+    parser.add_option(args.threads, sharg::config{
+        .short_id = 't',
+        .long_id = "threads",
+        .description = "number of threads. records are scored in parallel, long records are split into overlapping chunks."});
+    parser.add_option(args.input, sharg::config{
+        .short_id = 'i',
+        .long_id = "input",
+        .description = "reference file in fasta format, needed for --regions. without --regions the fasta is read from stdin, plain or compressed with gzip or bgzip.",
+        .validator = sharg::input_file_validator{{"fa", "fasta"}}});
+    parser.add_option(args.regions, sharg::config{
+        .long_id = "regions",
+        .description = "only score the regions of this bed file, one value per base of every region.",
+        .validator = sharg::input_file_validator{{"bed"}}});
+    parser.add_option(args.format, sharg::config{
+        .long_id = "format",
+        .description = "output format. text writes one score per line, bed one line with chrom, start, end and score per base, bedgraph merges runs of equal scores into one such line, bigwig writes an indexed bigWig file with zoom levels for genome browsers, f32 writes a binary float32 track that numpy can memory map, u8 and u16 write a compact quantized track.",
+        .validator = sharg::value_list_validator{seqomplexity::sink_formats()}});
+    parser.add_option(args.output, sharg::config{
+        .short_id = 'o',
+        .long_id = "output",
+        .description = "output file, stdout if not given. needed for the binary formats. text output to a .gz or .bgz file is compressed with bgzip on --threads threads.",
+        .validator = sharg::output_file_validator{sharg::output_file_open_options::open_or_create}});
+    parser.add_option(args.precision, sharg::config{
+        .long_id = "precision",
+        .description = "digits after the decimal point of the text output. without it the values keep 6 significant digits. bedgraph merges scores that are equal at this precision.",
+        .validator = sharg::arithmetic_range_validator{0, seqomplexity::max_precision}});
+    parser.add_option(args.gc_wsize, sharg::config{
+        .long_id = "gc-wsize",
+        .description = "also compute the GC content within windows of this size in the same pass. text output gets a second column, the other formats a second file, the tracks are named like out.complexity.f32 and out.gc.f32."});
+    parser.add_option(args.mask_below, sharg::config{
+        .long_id = "mask-below",
+        .description = "write the intervals of bases scoring below this threshold as bed lines with chrom, start and end instead of the scores. every base has the score of the default output. masking is off without a threshold above 0."});
+    parser.add_option(args.mask_min_length, sharg::config{
+        .long_id = "mask-min-length",
+        .description = "drop masked intervals shorter than this, after merging."});
+    parser.add_option(args.mask_merge_gap, sharg::config{
+        .long_id = "mask-merge-gap",
+        .description = "merge masked intervals that are at most this many bases apart."});
+    parser.add_option(args.masked_fasta, sharg::config{
+        .long_id = "masked-fasta",
+        .description = "with --mask-below, also write the input to this fasta file with the masked bases in lowercase, 60 bases per line. a .gz or .bgz file is compressed with bgzip.",
+        .validator = sharg::output_file_validator{sharg::output_file_open_options::open_or_create}});
+    parser.add_option(args.cache_dir, sharg::config{
+        .long_id = "cache-dir",
+        .description = "reuse the scores of records that were scored before with the same w and k from this directory, and store new ones there. the records are scored whole on one thread, hits and misses are reported on stderr."});
+    parser.add_flag(args.pipeline, sharg::config{
+        .long_id = "pipeline",
+        .description = "read, score, format and write on four threads connected by bounded queues. the run then takes about as long as its slowest stage. scoring stays on one thread, use --threads instead to score in parallel."});
+    parser.add_option(args.queue_depth, sharg::config{
+        .long_id = "queue-depth",
+        .description = "batches every queue of --pipeline holds.",
+        .validator = sharg::arithmetic_range_validator{1, 1024}});
+    parser.add_option(args.pipeline_memory, sharg::config{
+        .long_id = "pipeline-memory",
+        .description = "MiB all queues of --pipeline hold at most, the batches are sized to fit.",
+        .validator = sharg::arithmetic_range_validator{1, 1 << 20}});
+}
+
+// build-index: computes the scores of a reference once into a score archive
+struct build_index_arguments
+{
+    size_t wsize{};
+    std::vector<uint8_t> kmers{};
+    size_t threads{1};
+    std::filesystem::path output{};
+    uint32_t block_size{seqomplexity::score_archive_format::default_block_size};
+};
+
+int build_index_main(int argc, char ** argv)
+{
+    sharg::parser parser{"sequence-complexity-build-index", argc, argv};
+    build_index_arguments args{};
+    parser.info.author = "VM";
+    parser.info.short_description = "computes the sequence complexity of a fasta from stdin once and stores it in a score archive for fast region queries.";
+    parser.info.version = "0.0.1";
+    parser.add_option(args.wsize, sharg::config{
+        .short_id = 'w',
+        .long_id = "wsize",
+        .description = "window size w must be 1 < w < 2^28."});
+    parser.add_option(args.kmers, sharg::config{
+        .short_id = 'k',
+        .long_id = "kmers",
+        .description = "any k must be 0 < k < 32 and k < w+1."});
+    parser.add_option(args.threads, sharg::config{
+        .short_id = 't',
+        .long_id = "threads",
+        .description = "number of threads. records are scored in parallel, long records are split into overlapping chunks."});
+    parser.add_option(args.output, sharg::config{
+        .short_id = 'o',
+        .long_id = "output",
+        .description = "the score archive to write.",
+        .required = true,
+        .validator = sharg::output_file_validator{sharg::output_file_open_options::open_or_create, {"sqx"}}});
+    parser.add_option(args.block_size, sharg::config{
+        .long_id = "block-size",
+        .description = "scores per compressed block. a query inflates every block it overlaps, smaller blocks make short queries faster and the archive larger.",
+        .validator = sharg::arithmetic_range_validator{1, 1 << 24}});
+    try
+    {
+        parser.parse();
+    }
+    catch (sharg::parser_error const & ext)
+    {
+        std::cerr << "[Winter has come] " << ext.what() << "\n";
+        return -1;
+    }
+    try
+    {
+        seqomplexity::score_archive_sink sink(args.output.string(), args.wsize, args.kmers, args.block_size);
+        std::unique_ptr<seqomplexity::input_source> input = seqomplexity::open_input(STDIN_FILENO, args.threads);
+        if (args.threads > 1)
+        {
+            run_program_parallel(args.wsize, args.kmers, args.threads, *input, sink);
+        }
+        else
+        {
+            run_program(args.wsize, args.kmers, *input, sink);
+        }
+        sink.finish();
+    }
+    catch (std::exception const & e)
+    {
+        std::cerr << e.what() << std::endl;
+        return 1;
+    }
+    return 0;
+}
+
+// query: reads the scores of regions from a score archive
+struct query_arguments
+{
+    std::filesystem::path archive{};
+    std::vector<std::string> regions{};
+    std::filesystem::path regions_file{};
+    std::string format{"text"};
+    std::filesystem::path output{};
+    int precision{seqomplexity::default_precision};
+};
+
+// a region given as chrom, chrom:start-end or chrom:start-. start and end are
+// 1-based and inclusive like in samtools, the region is returned 0-based and
+// half-open like the regions of a bed file.
+region parse_region(std::string const & text, seqomplexity::score_archive const & archive)
+{
+    region r;
+    size_t colon = text.rfind(':');
+    seqomplexity::score_archive::record_info const * record = archive.find(text);
+    if (record == nullptr && colon != std::string::npos)
+    {
+        record = archive.find(text.substr(0, colon));
+        std::istringstream range(text.substr(colon + 1));
+        char dash(0);
+        if (record == nullptr || !(range >> r.start >> dash) || dash != '-')
+        {
+            record = nullptr;
+        }
+        else if (r.start == 0)
+        {
+            std::cerr << "The region " << text << " starts at 0, positions are 1-based." << std::endl;
+            exit(1);
+        }
+        else
+        {
+            // the end of a 1-based inclusive range is the end of the half-open one
+            r.start--;
+            if (!(range >> r.end))
+            {
+                r.end = record->length;
+            }
+            else if (r.end <= r.start)
+            {
+                record = nullptr;
+            }
+        }
+    }
+    else if (record != nullptr)
+    {
+        r.end = record->length;
+    }
+    if (record == nullptr || r.start > r.end || r.end > record->length)
+    {
+        std::cerr << "The region " << text << " is not part of the archive." << std::endl;
+        exit(1);
+    }
+    r.chrom = record->name;
+    return r;
+}
+
+int query_main(int argc, char ** argv)
+{
+    sharg::parser parser{"sequence-complexity-query", argc, argv};
+    query_arguments args{};
+    parser.info.author = "VM";
+    parser.info.short_description = "reads the sequence complexity of regions from a score archive written by build-index.";
+    parser.info.version = "0.0.1";
+    parser.add_option(args.archive, sharg::config{
+        .short_id = 'i',
+        .long_id = "input",
+        .description = "the score archive.",
+        .required = true,
+        .validator = sharg::input_file_validator{{"sqx"}}});
+    parser.add_option(args.regions, sharg::config{
+        .short_id = 'r',
+        .long_id = "region",
+        .description = "a region as chrom, chrom:start-end or chrom:start-, start and end are 1-based and inclusive like in samtools. can be given several times."});
+    parser.add_option(args.regions_file, sharg::config{
+        .long_id = "regions",
+        .description = "the regions of this bed file, after those of --region.",
+        .validator = sharg::input_file_validator{{"bed"}}});
+    parser.add_option(args.format, sharg::config{
+        .long_id = "format",
+        .description = "output format, see the main command.",
+        .validator = sharg::value_list_validator{seqomplexity::sink_formats()}});
+    parser.add_option(args.output, sharg::config{
+        .short_id = 'o',
+        .long_id = "output",
+        .description = "output file, stdout if not given. needed for the binary formats.",
+        .validator = sharg::output_file_validator{sharg::output_file_open_options::open_or_create}});
+    parser.add_option(args.precision, sharg::config{
+        .long_id = "precision",
+        .description = "digits after the decimal point of the text output. without it the values keep 6 significant digits.",
+        .validator = sharg::arithmetic_range_validator{0, seqomplexity::max_precision}});
+    try
+    {
+        parser.parse();
+    }
+    catch (sharg::parser_error const & ext)
+    {
+        std::cerr << "[Winter has come] " << ext.what() << "\n";
+        return -1;
+    }
+    try
+    {
+        seqomplexity::score_archive archive(args.archive.string());
+        std::vector<region> regions;
+        for (std::string const & text : args.regions)
+        {
+            regions.push_back(parse_region(text, archive));
+        }
+        if (!args.regions_file.empty())
+        {
+            for (region const & r : read_regions(args.regions_file))
+            {
+                seqomplexity::score_archive::record_info const * record = archive.find(r.chrom);
+                if (record == nullptr || r.end > record->length)
+                {
+                    std::cerr << "The region " << r.chrom << ':' << r.start << '-' << r.end << " is not part of the archive." << std::endl;
+                    return 1;
+                }
+                regions.push_back(r);
+            }
+        }
+        std::unique_ptr<seqomplexity::score_sink> sink = seqomplexity::make_score_sink(
+            args.format, args.output.string(), archive.window_size(), archive.kmers(), args.precision, 1);
+        std::vector<float> values;
+        for (region const & r : regions)
+        {
+            archive.fetch(*archive.find(r.chrom), r.start, r.end, values);
+            sink->begin_region(r.chrom, r.start, r.end);
+            sink->write(values.data(), values.size());
+            sink->end_record();
+        }
+        sink->finish();
+    }
+    catch (std::exception const & e)
+    {
+        std::cerr << e.what() << std::endl;
+        return 1;
+    }
+    return 0;
 }
  
 int main(int argc, char ** argv)
 {
+    // the subcommands come first, everything else is the streaming tool
+    if (argc > 1 && std::string(argv[1]) == "build-index")
+    {
+        return build_index_main(argc - 1, argv + 1);
+    }
+    if (argc > 1 && std::string(argv[1]) == "query")
+    {
+        return query_main(argc - 1, argv + 1);
+    }
     sharg::parser parser{"sequence-complexity", argc, argv}; // initialise myparser
     cmd_arguments args{};
     initialise_parser(parser, args);
@@ -289,7 +1332,104 @@ int main(int argc, char ** argv)
  
     // parsing was successful !
     // we can start running our program
-    run_program(args.wsize, args.kmers);
+    if (!args.regions.empty() && args.input.empty())
+    {
+        std::cerr << "--regions needs the fasta file given with --input." << std::endl;
+        return 1;
+    }
+    if (args.gc_wsize > 0 && !args.regions.empty())
+    {
+        std::cerr << "--gc-wsize can not be combined with --regions." << std::endl;
+        return 1;
+    }
+    if (args.mask_below > 0 && (args.gc_wsize > 0 || args.format != "text"))
+    {
+        std::cerr << "--mask-below writes bed intervals and can not be combined with --gc-wsize or --format." << std::endl;
+        return 1;
+    }
+    if (!args.cache_dir.empty() && (args.gc_wsize > 0 || !args.regions.empty() || !args.masked_fasta.empty()))
+    {
+        std::cerr << "--cache-dir can not be combined with --gc-wsize, --regions or --masked-fasta." << std::endl;
+        return 1;
+    }
+    if (args.pipeline && (args.threads > 1 || args.gc_wsize > 0 || !args.regions.empty() || !args.masked_fasta.empty() || !args.cache_dir.empty()))
+    {
+        std::cerr << "--pipeline can not be combined with --threads, --gc-wsize, --regions, --masked-fasta or --cache-dir." << std::endl;
+        return 1;
+    }
+    if (!args.masked_fasta.empty() && (args.mask_below <= 0 || !args.regions.empty()))
+    {
+        std::cerr << "--masked-fasta needs --mask-below and can not be combined with --regions." << std::endl;
+        return 1;
+    }
+    try
+    {
+        if (!args.masked_fasta.empty())
+        {
+            // the masked fasta is written on one thread, more threads decompress and compress
+            seqomplexity::mask_sink mask(seqomplexity::open_text_output(args.output.string(), args.threads),
+                                         args.mask_below, args.mask_min_length, args.mask_merge_gap);
+            std::unique_ptr<seqomplexity::byte_output> fasta = seqomplexity::open_text_output(args.masked_fasta.string(), args.threads);
+            std::unique_ptr<seqomplexity::input_source> input = seqomplexity::open_input(STDIN_FILENO, args.threads);
+            run_program_masked(args.wsize, args.kmers, *input, mask, *fasta);
+            mask.finish();
+            fasta->finish();
+            return 0;
+        }
+        if (args.gc_wsize > 0)
+        {
+            // the fused mode runs on one thread, more threads decompress and compress
+            std::unique_ptr<seqomplexity::multi_track_output> output = make_fused_output(
+                args.format, args.output.string(), args.wsize, args.kmers, args.gc_wsize, args.precision, args.threads);
+            std::unique_ptr<seqomplexity::input_source> input = seqomplexity::open_input(STDIN_FILENO, args.threads);
+            run_program_fused(args.wsize, args.kmers, args.gc_wsize, *input, *output);
+            output->finish();
+            return 0;
+        }
+        std::unique_ptr<seqomplexity::score_sink> sink;
+        if (args.mask_below > 0)
+        {
+            sink = std::make_unique<seqomplexity::mask_sink>(seqomplexity::open_text_output(args.output.string(), args.threads),
+                                                             args.mask_below, args.mask_min_length, args.mask_merge_gap);
+        }
+        else
+        {
+            sink = seqomplexity::make_score_sink(args.format, args.output.string(), args.wsize, args.kmers, args.precision, args.threads);
+        }
+        if (!args.regions.empty())
+        {
+            run_program_regions(args.input, args.regions, args.wsize, args.kmers, args.threads, *sink);
+        }
+        else if (args.pipeline)
+        {
+            std::unique_ptr<seqomplexity::input_source> input = seqomplexity::open_input(STDIN_FILENO, 1);
+            run_program_pipelined(args.wsize, args.kmers, args.queue_depth, args.pipeline_memory << 20, *input, *sink);
+        }
+        else if (!args.cache_dir.empty())
+        {
+            seqomplexity::score_cache cache(args.cache_dir, args.wsize, args.kmers);
+            std::unique_ptr<seqomplexity::input_source> input = seqomplexity::open_input(STDIN_FILENO, args.threads);
+            run_program_cached(args.wsize, args.kmers, cache, *input, *sink);
+            std::cerr << "cache: " << cache.hits << " hits, " << cache.misses << " misses, "
+                      << cache.bases_reused << " bases reused." << std::endl;
+        }
+        else if (args.threads > 1)
+        {
+            std::unique_ptr<seqomplexity::input_source> input = seqomplexity::open_input(STDIN_FILENO, args.threads);
+            run_program_parallel(args.wsize, args.kmers, args.threads, *input, *sink);
+        }
+        else
+        {
+            std::unique_ptr<seqomplexity::input_source> input = seqomplexity::open_input(STDIN_FILENO);
+            run_program(args.wsize, args.kmers, *input, *sink);
+        }
+        sink->finish();
+    }
+    catch (std::exception const & e)
+    {
+        std::cerr << e.what() << std::endl;
+        return 1;
+    }
  
     return 0;
 }
\ No newline at end of file
@@ -3,173 +3,81 @@
  
 #include <seqan3/core/debug_stream.hpp>
 #include <seqan3/io/sequence_file/all.hpp>
- 
-
-size_t kmer_to_hash(std::vector<seqan3::dna5> & sequence, size_t it_start, size_t it_end, size_t base=3)
-{
-    size_t hashvalue = 0;
-    for (size_t i = it_start; i < it_end; i++)
-    {
-        hashvalue = (hashvalue << base) + seqan3::to_rank(sequence[i]);
-    }
-    return hashvalue;
-}
-
-std::vector<size_t> sequence_to_kmer_hashes(
-    std::vector<seqan3::dna5> & sequence,
-    size_t k,
-    size_t it_start,
-    size_t it_end)
-{
-    //body
-    // return [kmer_to_hash(seq[i:i+k]) for i in range(len(seq)-k+1)]
-    std::vector<size_t> hashvalues(it_end - it_start -k+1);
-    for (size_t i = it_start; i < it_end-k+1; i++)
-    {
-        hashvalues[i-it_start] = kmer_to_hash(sequence,i,i+k);
-    }
-    return hashvalues;
-}
-
-size_t extend_hash(size_t kmer_hash, uint8_t letter_dna5 , size_t k, size_t base=3)
-{
-    return ((kmer_hash << base) + letter_dna5) & ((1 << (k*base))-1);
-}
 
-float product(std::vector<size_t> & a, std::vector<size_t> & b)
-{
-    float result(1.0);
-    for (size_t i = 0; i < std::min(a.size(),b.size()); i++)
-    {
-        result *= (float(a[i]) / float(b[i]));
-    }
-    return result;
-}
+#include <seqomplexity/fasta_reader.hpp>
+#include <seqomplexity/seqan3_views.hpp>
+#include <seqomplexity/sinks.hpp>
+#include <seqomplexity/sliding_complexity.hpp>
+ 
 
+// writes the scores of one record, computed lazily by a complexity view over
+// its bases, to the sink in batches
+template <typename complexity_adaptor_t>
 void sequence_complexity(
     std::vector<seqan3::dna5> & sequence,
-    size_t W,
-    std::vector<uint8_t> kmers)
+    complexity_adaptor_t const & complexity,
+    seqomplexity::score_sink & sink)
 {
-    size_t N(sequence.size());
-    // --- setup --- //
-    //std::vector<float> results(N,float(0.0));
-    std::vector<size_t> MAX_UNIQUE_HASHES(kmers.size());
-    for (size_t i = 0; i < kmers.size(); i++){
-        MAX_UNIQUE_HASHES[i] = std::min(W-kmers[i]+1,size_t(pow(4,kmers[i])));
-    }
-    // --- init --- //
-    // starting k-mers
-    // k-mers are saved each as a hash code. Each vector saves all hash values of all k-mers in the current window.
-    std::vector<std::vector<size_t>> kmer_hashes(kmers.size());
-    for (size_t i = 0; i < kmers.size(); i++)
-    {
-        kmer_hashes[i] = sequence_to_kmer_hashes(sequence, kmers[i], 0, W);
-    }
-    // starting unique k-mer counts
-    std::vector<size_t> current_unique_n_hashes(kmers.size());
-    for (size_t i = 0; i < kmers.size(); i++)
-    {
-        current_unique_n_hashes[i] = std::set<size_t>(kmer_hashes[i].begin(), kmer_hashes[i].end() ).size();
-    }
-    // save resulting scores
-    //results[size_t(W/2)] = product(current_unique_n_hashes,MAX_UNIQUE_HASHES);
-
-    // cout padding
-    for (size_t i = 0; i < size_t(W/2)+1; i++)
+    constexpr size_t batch_size = size_t(1) << 16;
+    std::vector<float> batch;
+    batch.reserve(batch_size);
+    for (float score : sequence | complexity)
     {
-        // std::cout << i << '\n';
-        std::cout << product(current_unique_n_hashes,MAX_UNIQUE_HASHES) << '\n';
-        // print_current_unique_hashes(current_unique_n_hashes);
-    }
-    
-    // for (size_t hashval : kmer_hashes[0])
-    // {
-    //     std::cout << hashval << '\t';
-    // }
-    // std::cout << '\n';
-    // print_seq_interval(sequence,0,W);
-
-
-    // std::cout << "main loop\n";
-    // main loop
-    for (size_t i = 1; i < N-W+1; i++)
-    {
-        // std::cout << "# --- #\n";
-        // print_seq_interval(sequence,i,i+W);
-        size_t h = seqan3::to_rank(sequence[i+W-1]);
-        for (size_t j = 0; j < kmers.size(); j++)
+        batch.push_back(score);
+        if (batch.size() == batch_size)
         {
-            size_t k = kmers[j];
-            size_t k_base_length(W-k+1);
-            size_t position = size_t((k_base_length+i-1)%(k_base_length));
-            size_t last_position=size_t((k_base_length+i-2)%(k_base_length));
-            size_t old_hash = kmer_hashes[j][last_position];
-            bool last_hash_unique = std::count(kmer_hashes[j].begin(), kmer_hashes[j].end(), kmer_hashes[j][position]) == 1;
-            current_unique_n_hashes[j] -= size_t(last_hash_unique);
-            size_t new_hash = extend_hash(old_hash,h,k);
-            kmer_hashes[j][position]=new_hash;
-            // update count of unique elements in k-mers
-            bool new_hash_unique = std::count(kmer_hashes[j].begin(), kmer_hashes[j].end(), new_hash) == 1;
-            current_unique_n_hashes[j] += int(new_hash_unique);
-            // for (size_t hashval : kmer_hashes[j])
-            // {
-            //     std::cout << hashval << '\t';
-            // }
-            // std::cout << '\n';
-            // std::cout << "position: " << position << " last position: " << last_position << " kmer: " << k << " old hash: " << old_hash << " new hash: " << new_hash << " new letter: " << seqan3::to_char(sequence[i+W-1]) << '\n';
+            sink.write(batch.data(), batch.size());
+            batch.clear();
         }
-        // std::cout << i+size_t(W/2) << '\n';
-        std::cout << product(current_unique_n_hashes,MAX_UNIQUE_HASHES) << '\n';
-        // print_current_unique_hashes(current_unique_n_hashes);
-        //results[i] = product(current_unique_n_hashes,MAX_UNIQUE_HASHES);
     }
-    for (size_t i = N-size_t(W/2); i < N; i++)
-    {
-        // std::cout << (i+size_t(W/2)) << '\n';
-        std::cout << product(current_unique_n_hashes,MAX_UNIQUE_HASHES) << '\n';
-        // print_current_unique_hashes(current_unique_n_hashes);
-    }
-    
+    sink.write(batch.data(), batch.size());
     return ;
 
 }
 
-
-void test_prog()
-{
-    using namespace seqan3::literals;
-    std::vector<seqan3::dna5> seq("ACGNAAAACCCCACT"_dna5);
-    std::vector<size_t> kmer_hashes = sequence_to_kmer_hashes(seq,3,0,5);
-    std::cout << "extend_hash(0,1,2,2) " << extend_hash(0,1,2,2) << " of: " << 1 << "\n";
-    std::cout << "extend_hash(1,0,2,2) " << extend_hash(1,1,2,2) << " of: " << 5 << "\n";
-    std::cout << "extend_hash(10,0,2,2) " << extend_hash(10,1,2,2) << " of: " << 9 << "\n";
-    std::cout << "extend_hash(64,0,2,2) " << extend_hash(64,1,3,3) << " of: " << 1 << "\n";
-    std::cout << "kmer_to_hash(seq, 0, 3, 3) =" << kmer_to_hash(seq, 0, 3, 3)  << " of: (ACG) " << 10 << "\n";
-    std::cout << "kmer_to_hash(seq, 1, 4, 3) =" << kmer_to_hash(seq, 1, 4, 3)  << " of: (CGN) " << 83 << "\n";
-
-}
-
 void run_program(
         std::filesystem::path & input,
-        //std::filesystem::path & output,
+        std::filesystem::path & output,
+        std::string const & format,
+        int precision,
         size_t wsize,
         std::vector<uint8_t> kmers)
 {
-    // test_prog();
+    std::string error = seqomplexity::sliding_complexity::check_parameters(wsize, kmers);
+    if (!error.empty())
+    {
+        std::cerr << error << std::endl;
+        exit(1);
+    }
+    auto complexity = seqomplexity::views::complexity(wsize, kmers);
+    std::unique_ptr<seqomplexity::score_sink> sink;
+    try
+    {
+        sink = seqomplexity::make_score_sink(format, output.string(), wsize, kmers, precision);
+    }
+    catch (std::exception const & e)
+    {
+        std::cerr << e.what() << std::endl;
+        exit(1);
+    }
     seqan3::sequence_file_input fin{input};
     for (auto & record : fin)
     {
         //seqan3::debug_stream << "ID:  " << record.id() << '\n'; // prints first ID in batch
-        sequence_complexity(record.sequence(), wsize, kmers);
+        sink->begin_record(seqomplexity::record_name(record.id()));
+        sequence_complexity(record.sequence(), complexity, *sink);
+        sink->end_record();
     }
+    sink->finish();
 }
 // -----------------------------------------------------------------------------
  
 struct cmd_arguments
 {
     std::filesystem::path input{};
-    //std::filesystem::path output{};
+    std::filesystem::path output{};
+    std::string format{"text"};
+    int precision{seqomplexity::default_precision};
     size_t wsize{};
     std::vector<uint8_t> kmers{};
 };
@@ -187,20 +95,27 @@ void initialise_parser(sharg::parser & parser, cmd_arguments & args)
         .description = "reference file in fasta format.",
         .required = true,
         .validator = sharg::input_file_validator{{"fa", "fasta"}}});
-    // parser.add_option(args.output, sharg::config{
-    //     .short_id = 'o',
-    //     .long_id = "output",
-    //     .description = "path to output memmap.",
-    //     .required = true,
-    //     .validator = sharg::output_file_validator{"fa", "fasta"}});
+    parser.add_option(args.output, sharg::config{
+        .short_id = 'o',
+        .long_id = "output",
+        .description = "path to output memmap, stdout if not given. needed for the binary formats. text output to a .gz or .bgz file is compressed with bgzip.",
+        .validator = sharg::output_file_validator{sharg::output_file_open_options::open_or_create}});
+    parser.add_option(args.format, sharg::config{
+        .long_id = "format",
+        .description = "output format. text writes one score per line, bed one line with chrom, start, end and score per base, bedgraph merges runs of equal scores into one such line, bigwig writes an indexed bigWig file with zoom levels for genome browsers, f32 writes a binary float32 track that numpy can memory map, u8 and u16 write a compact quantized track.",
+        .validator = sharg::value_list_validator{seqomplexity::sink_formats()}});
+    parser.add_option(args.precision, sharg::config{
+        .long_id = "precision",
+        .description = "digits after the decimal point of the text output. without it the values keep 6 significant digits. bedgraph merges scores that are equal at this precision.",
+        .validator = sharg::arithmetic_range_validator{0, seqomplexity::max_precision}});
     parser.add_option(args.wsize, sharg::config{
         .short_id = 'w',
         .long_id = "wsize",
-        .description = "window size w must be 2 < w < 21."});
+        .description = "window size w must be 1 < w < 2^28."});
     parser.add_option(args.kmers, sharg::config{
         .short_id = 'k',
         .long_id = "kmers",
-        .description = "any k must be 1 < k < w+1."});
+        .description = "any k must be 0 < k < 32 and k < w+1."});
 }
  
 int main(int argc, char ** argv)
@@ -221,7 +136,7 @@ int main(int argc, char ** argv)
  
     // parsing was successful !
     // we can start running our program
-    run_program(args.input, args.wsize, args.kmers);
+    run_program(args.input, args.output, args.format, args.precision, args.wsize, args.kmers);
  
     return 0;
 }
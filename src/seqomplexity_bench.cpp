@@ -0,0 +1,594 @@
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <span>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <seqomplexity/engine.hpp>
+#include <seqomplexity/score_format.hpp>
+#include <seqomplexity/sliding_complexity.hpp>
+#include <seqomplexity/work_stealing_pool.hpp>
+
+#ifndef SEQOMPLEXITY_BUILD_TYPE
+#define SEQOMPLEXITY_BUILD_TYPE "unknown"
+#endif
+
+// measures the throughput of the complexity and GC implementations on
+// synthetic genomes and writes the results as JSON, to compare versions
+
+// splitmix64, the same seed always gives the same genome
+struct random_bases
+{
+    uint64_t state;
+
+    uint64_t next()
+    {
+        uint64_t z = (state += 0x9e3779b97f4a7c15);
+        z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9;
+        z = (z ^ (z >> 27)) * 0x94d049bb133111eb;
+        return z ^ (z >> 31);
+    }
+
+    // uniform in [0, n)
+    size_t below(size_t n)
+    {
+        return size_t(next() % n);
+    }
+
+    char base()
+    {
+        return "ACGT"[next() & 3];
+    }
+};
+
+// uniform random bases, the worst case for the k-mer counters
+std::string random_genome(size_t n, uint64_t seed)
+{
+    random_bases rng{seed};
+    std::string genome(n, 'A');
+    for (char & c : genome)
+    {
+        c = rng.base();
+    }
+    return genome;
+}
+
+// tandem repeats of short units and mutated copies of earlier sequence, like
+// satellites and transposons, with some unique sequence in between
+std::string repeat_genome(size_t n, uint64_t seed)
+{
+    random_bases rng{seed};
+    std::string genome;
+    genome.reserve(n + 4096);
+    while (genome.size() < n)
+    {
+        size_t kind = rng.below(3);
+        if (kind == 0 || genome.size() < 4096)
+        {
+            // tandem repeat of a unit of 1 to 64 bases
+            std::string unit(1 + rng.below(64), 'A');
+            for (char & c : unit)
+            {
+                c = rng.base();
+            }
+            size_t length = 200 + rng.below(4000);
+            for (size_t i = 0; i < length; i++)
+            {
+                genome.push_back(unit[i % unit.size()]);
+            }
+        }
+        else if (kind == 1)
+        {
+            // copy of earlier sequence with 2% substitutions
+            size_t length = 300 + rng.below(3000);
+            size_t start = rng.below(genome.size() - std::min(length, genome.size() - 1));
+            for (size_t i = 0; i < length && start + i < genome.size(); i++)
+            {
+                genome.push_back(rng.below(50) == 0 ? rng.base() : genome[start + i]);
+            }
+        }
+        else
+        {
+            size_t length = 100 + rng.below(2000);
+            for (size_t i = 0; i < length; i++)
+            {
+                genome.push_back(rng.base());
+            }
+        }
+    }
+    genome.resize(n);
+    return genome;
+}
+
+// random bases with runs of N of 1 to 50 kb every 200 kb on average, like
+// the gaps of an assembly, and short runs of N in between
+std::string gapped_genome(size_t n, uint64_t seed)
+{
+    std::string genome = random_genome(n, seed);
+    random_bases rng{seed ^ 0x5eed};
+    for (size_t pos = rng.below(200000); pos < n; pos += 1 + rng.below(400000))
+    {
+        size_t length = 1000 + rng.below(49000);
+        std::fill(genome.begin() + pos, genome.begin() + std::min(n, pos + length), 'N');
+    }
+    for (size_t pos = rng.below(5000); pos < n; pos += 1 + rng.below(10000))
+    {
+        std::fill(genome.begin() + pos, genome.begin() + std::min(n, pos + 1 + rng.below(10)), 'N');
+    }
+    return genome;
+}
+
+struct genome
+{
+    std::string content;
+    std::string bases;
+};
+
+// the peak resident memory since the last reset in kB. resetting uses
+// /proc/self/clear_refs, where that is not available the peak is the one of
+// the whole process.
+void reset_peak_rss()
+{
+    std::ofstream("/proc/self/clear_refs") << "5";
+}
+
+size_t peak_rss_kb()
+{
+    std::ifstream status("/proc/self/status");
+    std::string line;
+    while (std::getline(status, line))
+    {
+        if (line.rfind("VmHWM:", 0) == 0)
+        {
+            return std::strtoull(line.c_str() + 6, nullptr, 10);
+        }
+    }
+    rusage usage{};
+    getrusage(RUSAGE_SELF, &usage);
+    return size_t(usage.ru_maxrss);
+}
+
+struct result
+{
+    std::string implementation;
+    std::string content;
+    size_t wsize;
+    std::vector<uint8_t> kmers;
+    size_t threads;
+    size_t bases;
+    double seconds;
+    size_t peak_rss_kb;
+    // a value derived from all scores, so the work can not be optimised away
+    // and different implementations can be checked against each other
+    double checksum;
+};
+
+// runs f repeats times and keeps the fastest run
+template <typename function_t>
+void measure(result & r, size_t repeats, function_t && f)
+{
+    r.seconds = 1e300;
+    r.peak_rss_kb = 0;
+    for (size_t i = 0; i < repeats; i++)
+    {
+        reset_peak_rss();
+        auto start = std::chrono::steady_clock::now();
+        r.checksum = f();
+        std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+        r.seconds = std::min(r.seconds, elapsed.count());
+        r.peak_rss_kb = std::max(r.peak_rss_kb, peak_rss_kb());
+    }
+}
+
+double sum(float const * scores, size_t n)
+{
+    double total(0.0);
+    for (size_t i = 0; i < n; i++)
+    {
+        total += scores[i];
+    }
+    return total;
+}
+
+// streams the bases through an engine in chunks like the streaming tools
+template <typename engine_t>
+double score_streaming(engine_t & engine, std::string const & bases)
+{
+    constexpr size_t chunk_size = size_t(1) << 16;
+    std::vector<float> scores(std::max(engine.max_scores(chunk_size), engine.max_finish_scores()));
+    double total(0.0);
+    for (size_t i = 0; i < bases.size(); i += chunk_size)
+    {
+        size_t m = std::min(chunk_size, bases.size() - i);
+        total += sum(scores.data(), engine.push(std::span<char const>(bases.data() + i, m), scores));
+    }
+    total += sum(scores.data(), engine.finish(scores));
+    return total;
+}
+
+// bases per record of the complexity_engine_contigs benchmark
+constexpr size_t contig_length = 2000;
+
+// streams the bases as records of record_length bases, like an assembly of
+// many short contigs, so the cost of starting a record shows up
+template <typename engine_t>
+double score_records(engine_t & engine, std::string const & bases, size_t record_length)
+{
+    std::vector<float> scores(std::max(engine.max_scores(record_length), engine.max_finish_scores()));
+    double total(0.0);
+    for (size_t i = 0; i < bases.size(); i += record_length)
+    {
+        size_t m = std::min(record_length, bases.size() - i);
+        total += sum(scores.data(), engine.push(std::span<char const>(bases.data() + i, m), scores));
+        total += sum(scores.data(), engine.finish(scores));
+    }
+    return total;
+}
+
+// same, and formats the scores as text like the default output of the tools
+double score_text(seqomplexity::complexity_engine & engine, std::string const & bases)
+{
+    constexpr size_t chunk_size = size_t(1) << 16;
+    std::vector<float> scores(std::max(engine.max_scores(chunk_size), engine.max_finish_scores()));
+    std::string text;
+    double total(0.0);
+    auto format = [&](size_t n)
+    {
+        text.clear();
+        seqomplexity::format_scores(scores.data(), n, seqomplexity::default_precision, text);
+        total += double(text.size());
+    };
+    for (size_t i = 0; i < bases.size(); i += chunk_size)
+    {
+        size_t m = std::min(chunk_size, bases.size() - i);
+        format(engine.push(std::span<char const>(bases.data() + i, m), scores));
+    }
+    format(engine.finish(scores));
+    return total;
+}
+
+// the windows are split into chunks that overlap by w - 1 bases and scored
+// on a work stealing pool like the parallel mode of fast_sequence_complexity
+double score_parallel(
+        size_t wsize,
+        std::vector<uint8_t> const & kmers,
+        size_t n_threads,
+        std::string const & bases)
+{
+    constexpr size_t windows_per_task = size_t(1) << 20;
+    if (bases.size() < wsize)
+    {
+        return 0.0;
+    }
+    size_t n_windows = bases.size() - wsize + 1;
+    size_t n_tasks = (n_windows + windows_per_task - 1) / windows_per_task;
+    std::vector<seqomplexity::sliding_complexity> workers(n_threads, seqomplexity::sliding_complexity(wsize, kmers));
+    std::vector<double> totals(n_tasks, 0.0);
+    {
+        seqomplexity::work_stealing_pool pool(n_threads);
+        for (size_t t = 0; t < n_tasks; t++)
+        {
+            pool.submit([&, t](size_t worker)
+            {
+                size_t begin = t * windows_per_task;
+                size_t end = std::min(n_windows, begin + windows_per_task);
+                std::vector<float> scores(end - begin);
+                workers[worker].score_windows(bases.data() + begin, end - begin, scores.data());
+                totals[t] = sum(scores.data(), scores.size());
+            });
+        }
+    }
+    double total(0.0);
+    for (double t : totals)
+    {
+        total += t;
+    }
+    return total;
+}
+
+// runs a shell command with the genome as FASTA on stdin and its output
+// discarded, returns the peak memory of the command in kB
+size_t run_command(std::string const & command, std::string const & fasta_path)
+{
+    pid_t pid = fork();
+    if (pid < 0)
+    {
+        std::cerr << "Could not start " << command << "." << std::endl;
+        exit(1);
+    }
+    if (pid == 0)
+    {
+        int in = open(fasta_path.c_str(), O_RDONLY);
+        int out = open("/dev/null", O_WRONLY);
+        if (in < 0 || out < 0)
+        {
+            _exit(127);
+        }
+        dup2(in, STDIN_FILENO);
+        dup2(out, STDOUT_FILENO);
+        execl("/bin/sh", "sh", "-c", command.c_str(), (char *) nullptr);
+        _exit(127);
+    }
+    int status(0);
+    rusage usage{};
+    wait4(pid, &status, 0, &usage);
+    if (!WIFEXITED(status) || WEXITSTATUS(status) != 0)
+    {
+        std::cerr << "The command " << command << " failed." << std::endl;
+        exit(1);
+    }
+    return size_t(usage.ru_maxrss);
+}
+
+std::string json_string(std::string const & s)
+{
+    std::string out = "\"";
+    for (char c : s)
+    {
+        if (c == '"' || c == '\\')
+        {
+            out += '\\';
+            out += c;
+        }
+        else if ((unsigned char)(c) < 0x20)
+        {
+            char escaped[8];
+            std::snprintf(escaped, sizeof(escaped), "\\u%04x", c);
+            out += escaped;
+        }
+        else
+        {
+            out += c;
+        }
+    }
+    return out + "\"";
+}
+
+std::string to_json(result const & r)
+{
+    std::ostringstream out;
+    out.precision(9);
+    out << "{\"implementation\": " << json_string(r.implementation)
+        << ", \"content\": " << json_string(r.content)
+        << ", \"w\": " << (r.wsize > 0 ? std::to_string(r.wsize) : "null")
+        << ", \"k\": [";
+    for (size_t i = 0; i < r.kmers.size(); i++)
+    {
+        out << (i > 0 ? ", " : "") << int(r.kmers[i]);
+    }
+    // the parameters of shell commands are not known
+    out << "], \"threads\": " << (r.threads > 0 ? std::to_string(r.threads) : "null")
+        << ", \"bases\": " << r.bases
+        << ", \"seconds\": " << r.seconds
+        << ", \"bases_per_second\": " << double(r.bases) / r.seconds
+        << ", \"ns_per_base\": " << r.seconds * 1e9 / double(r.bases)
+        << ", \"peak_rss_kb\": " << r.peak_rss_kb
+        << ", \"checksum\": ";
+    if (r.wsize > 0)
+    {
+        out << r.checksum;
+    }
+    else
+    {
+        out << "null";
+    }
+    out << "}";
+    return out.str();
+}
+
+struct cmd_arguments {
+    size_t size;
+    uint64_t seed;
+    size_t repeats;
+    std::vector<size_t> wsizes;
+    std::vector<std::vector<uint8_t>> kmer_sets;
+    std::vector<size_t> threads;
+    std::vector<std::string> commands;
+    std::string output;
+};
+
+void print_help() {
+    std::cout << "Usage: seqomplexity_bench [options]\n"
+              << "Options:\n"
+              << "  -s   bases per synthetic genome (default: 4194304)\n"
+              << "  -S   seed of the genome generator (default: 1)\n"
+              << "  -r   runs per measurement, the fastest is reported (default: 3)\n"
+              << "  -w   comma separated window sizes (default: 21,101,1001)\n"
+              << "  -k   comma separated k values of one k set, may be repeated (default: -k 1,2,3 -k 2,3,4,5,6,7,8,9,10)\n"
+              << "  -t   comma separated thread counts of the parallel mode (default: 1 and all cores)\n"
+              << "  -x   label=command, also time a shell command that reads the genome as fasta from stdin, may be repeated\n"
+              << "  -o   write the JSON report to this file instead of stdout\n";
+}
+
+template <typename value_t>
+std::vector<value_t> parse_list(std::string const & list, char const * option)
+{
+    std::vector<value_t> values;
+    std::istringstream fields(list);
+    std::string field;
+    while (std::getline(fields, field, ','))
+    {
+        char * end = nullptr;
+        unsigned long long value = std::strtoull(field.c_str(), &end, 10);
+        if (field.empty() || *end != '\0' || value == 0)
+        {
+            std::cerr << "Error: Invalid value for " << option << ". Please provide comma separated positive integers.\n";
+            print_help();
+            std::exit(EXIT_FAILURE);
+        }
+        values.push_back(value_t(value));
+    }
+    return values;
+}
+
+void parse_arguments(int argc, char **argv, cmd_arguments &args) {
+    args.size = size_t(1) << 22;
+    args.seed = 1;
+    args.repeats = 3;
+    args.wsizes = {21, 101, 1001};
+    args.threads = {1, std::max(size_t(std::thread::hardware_concurrency()), size_t(1))};
+
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "-h") {
+            print_help();
+            std::exit(EXIT_SUCCESS);
+        }
+        if (i + 1 >= argc) {
+            std::cerr << "Error: " << arg << " option requires an argument.\n";
+            print_help();
+            std::exit(EXIT_FAILURE);
+        }
+        std::string value = argv[++i];
+        if (arg == "-s") {
+            args.size = parse_list<size_t>(value, "-s").at(0);
+        } else if (arg == "-S") {
+            args.seed = std::strtoull(value.c_str(), nullptr, 10);
+        } else if (arg == "-r") {
+            args.repeats = parse_list<size_t>(value, "-r").at(0);
+        } else if (arg == "-w") {
+            args.wsizes = parse_list<size_t>(value, "-w");
+        } else if (arg == "-k") {
+            args.kmer_sets.push_back(parse_list<uint8_t>(value, "-k"));
+        } else if (arg == "-t") {
+            args.threads = parse_list<size_t>(value, "-t");
+        } else if (arg == "-x") {
+            if (value.find('=') == std::string::npos) {
+                std::cerr << "Error: Invalid value for -x. Please provide label=command.\n";
+                print_help();
+                std::exit(EXIT_FAILURE);
+            }
+            args.commands.push_back(value);
+        } else if (arg == "-o") {
+            args.output = value;
+        } else {
+            std::cerr << "Error: Unknown option '" << arg << "'.\n";
+            print_help();
+            std::exit(EXIT_FAILURE);
+        }
+    }
+    if (args.kmer_sets.empty()) {
+        args.kmer_sets = {{1, 2, 3}, {2, 3, 4, 5, 6, 7, 8, 9, 10}};
+    }
+    std::sort(args.threads.begin(), args.threads.end());
+    args.threads.erase(std::unique(args.threads.begin(), args.threads.end()), args.threads.end());
+}
+
+int main(int argc, char **argv) {
+    cmd_arguments args;
+    parse_arguments(argc, argv, args);
+
+    std::vector<genome> genomes = {
+        {"random", random_genome(args.size, args.seed)},
+        {"repeat", repeat_genome(args.size, args.seed)},
+        {"gapped", gapped_genome(args.size, args.seed)}};
+
+    std::vector<result> results;
+    auto report = [&](result const & r)
+    {
+        std::cerr << r.implementation << ' ' << r.content << " w=" << r.wsize << " t=" << r.threads
+                  << ": " << double(r.bases) / r.seconds / 1e6 << " Mbases/s" << std::endl;
+        results.push_back(r);
+    };
+    for (genome const & g : genomes)
+    {
+        for (size_t wsize : args.wsizes)
+        {
+            for (std::vector<uint8_t> const & kmers : args.kmer_sets)
+            {
+                std::string error = seqomplexity::sliding_complexity::check_parameters(wsize, kmers);
+                if (!error.empty())
+                {
+                    std::cerr << "Skipping w=" << wsize << ": " << error << std::endl;
+                    continue;
+                }
+                seqomplexity::complexity_engine engine(wsize, kmers);
+                result r{"complexity_engine", g.content, wsize, kmers, 1, g.bases.size(), 0.0, 0, 0.0};
+                measure(r, args.repeats, [&]() { return score_streaming(engine, g.bases); });
+                report(r);
+                r.implementation = "complexity_engine_contigs";
+                measure(r, args.repeats, [&]() { return score_records(engine, g.bases, contig_length); });
+                report(r);
+                r.implementation = "complexity_engine_text";
+                measure(r, args.repeats, [&]() { return score_text(engine, g.bases); });
+                report(r);
+                for (size_t n_threads : args.threads)
+                {
+                    r.implementation = "complexity_parallel";
+                    r.threads = n_threads;
+                    measure(r, args.repeats, [&]() { return score_parallel(wsize, kmers, n_threads, g.bases); });
+                    report(r);
+                }
+            }
+            seqomplexity::gc_engine engine(wsize);
+            result r{"gc_engine", g.content, wsize, {}, 1, g.bases.size(), 0.0, 0, 0.0};
+            measure(r, args.repeats, [&]() { return score_streaming(engine, g.bases); });
+            report(r);
+        }
+        if (!args.commands.empty())
+        {
+            // the commands read the genome as fasta with lines of 60 bases
+            std::string fasta_path = "seqomplexity_bench_" + g.content + ".fa";
+            {
+                std::ofstream fasta(fasta_path, std::ios::binary);
+                fasta << '>' << g.content << '\n';
+                for (size_t i = 0; i < g.bases.size(); i += 60)
+                {
+                    fasta.write(g.bases.data() + i, std::min(size_t(60), g.bases.size() - i));
+                    fasta << '\n';
+                }
+            }
+            for (std::string const & command : args.commands)
+            {
+                size_t split = command.find('=');
+                result r{command.substr(0, split), g.content, 0, {}, 0, g.bases.size(), 0.0, 0, 0.0};
+                r.seconds = 1e300;
+                for (size_t i = 0; i < args.repeats; i++)
+                {
+                    auto start = std::chrono::steady_clock::now();
+                    r.peak_rss_kb = std::max(r.peak_rss_kb, run_command(command.substr(split + 1), fasta_path));
+                    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+                    r.seconds = std::min(r.seconds, elapsed.count());
+                }
+                report(r);
+            }
+            std::remove(fasta_path.c_str());
+        }
+    }
+
+    std::ostringstream json;
+    json << "{\n  \"schema\": 1,\n  \"build_type\": " << json_string(SEQOMPLEXITY_BUILD_TYPE)
+         << ",\n  \"compiler\": " << json_string(__VERSION__)
+         << ",\n  \"hardware_threads\": " << std::thread::hardware_concurrency()
+         << ",\n  \"genome_size\": " << args.size
+         << ",\n  \"seed\": " << args.seed
+         << ",\n  \"repeats\": " << args.repeats
+         << ",\n  \"results\": [";
+    for (size_t i = 0; i < results.size(); i++)
+    {
+        json << (i > 0 ? ",\n    " : "\n    ") << to_json(results[i]);
+    }
+    json << "\n  ]\n}\n";
+    if (args.output.empty())
+    {
+        std::cout << json.str();
+    }
+    else
+    {
+        std::ofstream out(args.output);
+        out << json.str();
+    }
+    return 0;
+}
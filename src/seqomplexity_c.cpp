@@ -0,0 +1,242 @@
+#include <algorithm>
+#include <cstring>
+#include <new>
+#include <span>
+#include <stdexcept>
+#include <string>
+#include <variant>
+#include <vector>
+
+#include <seqomplexity/engine.hpp>
+#include <seqomplexity/seqomplexity.h>
+
+// an engine of either kind and a buffer for the padding that the engines
+// write beyond the scores of the bases pushed so far
+struct sqx_engine
+{
+    static constexpr size_t chunk_size = size_t(1) << 16;
+
+    template <typename engine_t>
+    explicit sqx_engine(engine_t engine) :
+        engine(std::move(engine)),
+        scratch(std::max(max_scores(chunk_size), max_finish_scores()))
+    {}
+
+    std::variant<seqomplexity::complexity_engine, seqomplexity::gc_engine> engine;
+    std::vector<float> scratch;
+
+    size_t window_size() const
+    {
+        return std::visit([](auto const & e) { return e.window_size(); }, engine);
+    }
+
+    size_t max_scores(size_t n) const
+    {
+        return std::visit([n](auto const & e) { return e.max_scores(n); }, engine);
+    }
+
+    size_t max_finish_scores() const
+    {
+        return std::visit([](auto const & e) { return e.max_finish_scores(); }, engine);
+    }
+
+    size_t push(char const * bases, size_t n, float * out, size_t out_size)
+    {
+        return std::visit([&](auto & e) { return e.push(std::span<char const>(bases, n), std::span<float>(out, out_size)); }, engine);
+    }
+
+    size_t finish(float * out, size_t out_size)
+    {
+        return std::visit([&](auto & e) { return e.finish(std::span<float>(out, out_size)); }, engine);
+    }
+
+    void reset()
+    {
+        std::visit([](auto & e) { e.reset(); }, engine);
+    }
+
+    // scores a whole sequence into out, which holds exactly n floats. the
+    // chunks are pushed straight into out while it has room for their bound
+    // of max_scores(m), only a last chunk without that room goes through the
+    // scratch buffer.
+    void score(char const * bases, size_t n, float * out)
+    {
+        reset();
+        size_t written(0);
+        for (size_t i = 0; i < n; i += chunk_size)
+        {
+            size_t m = std::min(chunk_size, n - i);
+            if (n - written >= max_scores(m))
+            {
+                written += push(bases + i, m, out + written, n - written);
+                continue;
+            }
+            size_t k = push(bases + i, m, scratch.data(), scratch.size());
+            std::memcpy(out + written, scratch.data(), k * sizeof(float));
+            written += k;
+        }
+        finish(out + written, n - written);
+    }
+};
+
+namespace
+{
+
+thread_local std::string last_error{};
+
+sqx_status fail(sqx_status status, char const * message)
+{
+    last_error = message;
+    return status;
+}
+
+// runs f and turns exceptions into a status, none may cross the C interface
+template <typename function_t>
+sqx_status guarded(function_t && f)
+{
+    try
+    {
+        f();
+        return SQX_OK;
+    }
+    catch (std::bad_alloc const &)
+    {
+        return fail(SQX_OUT_OF_MEMORY, "out of memory.");
+    }
+    catch (std::invalid_argument const & e)
+    {
+        return fail(SQX_INVALID_ARGUMENT, e.what());
+    }
+    catch (std::length_error const & e)
+    {
+        return fail(SQX_BUFFER_TOO_SMALL, e.what());
+    }
+    catch (std::exception const & e)
+    {
+        return fail(SQX_ERROR, e.what());
+    }
+    catch (...)
+    {
+        return fail(SQX_ERROR, "unknown error.");
+    }
+}
+
+template <typename make_engine_t>
+sqx_engine * new_engine(make_engine_t && make_engine)
+{
+    sqx_engine * engine = nullptr;
+    guarded([&]() { engine = new sqx_engine(make_engine()); });
+    return engine;
+}
+
+} // namespace
+
+extern "C" {
+
+int sqx_abi_version(void)
+{
+    return SQX_ABI_VERSION;
+}
+
+char const * sqx_last_error(void)
+{
+    return last_error.c_str();
+}
+
+sqx_engine * sqx_complexity_engine_new(size_t wsize, uint8_t const * kmers, size_t n_kmers)
+{
+    if (kmers == nullptr && n_kmers > 0)
+    {
+        fail(SQX_INVALID_ARGUMENT, "kmers is NULL.");
+        return nullptr;
+    }
+    return new_engine([&]()
+    {
+        return seqomplexity::complexity_engine(wsize, std::vector<uint8_t>(kmers, kmers + n_kmers));
+    });
+}
+
+sqx_engine * sqx_gc_engine_new(size_t wsize)
+{
+    return new_engine([&]() { return seqomplexity::gc_engine(wsize); });
+}
+
+void sqx_engine_free(sqx_engine * engine)
+{
+    delete engine;
+}
+
+size_t sqx_engine_window_size(sqx_engine const * engine)
+{
+    return engine->window_size();
+}
+
+sqx_status sqx_engine_score(sqx_engine * engine, char const * bases, size_t n, float * out, size_t out_size)
+{
+    if (out_size < n)
+    {
+        return fail(SQX_BUFFER_TOO_SMALL, "out must hold one score per base.");
+    }
+    return guarded([&]() { engine->score(bases, n, out); });
+}
+
+sqx_status sqx_engine_score_batch(
+    sqx_engine * engine,
+    char const * bases,
+    size_t const * offsets,
+    size_t n_sequences,
+    float * out,
+    size_t out_size)
+{
+    for (size_t i = 0; i < n_sequences; i++)
+    {
+        if (offsets[i] > offsets[i + 1])
+        {
+            return fail(SQX_INVALID_ARGUMENT, "the offsets must not decrease.");
+        }
+    }
+    if (n_sequences > 0 && out_size < offsets[n_sequences])
+    {
+        return fail(SQX_BUFFER_TOO_SMALL, "out must hold one score per base.");
+    }
+    return guarded([&]()
+    {
+        for (size_t i = 0; i < n_sequences; i++)
+        {
+            engine->score(bases + offsets[i], offsets[i + 1] - offsets[i], out + offsets[i]);
+        }
+    });
+}
+
+size_t sqx_engine_max_scores(sqx_engine const * engine, size_t n)
+{
+    return engine->max_scores(n);
+}
+
+size_t sqx_engine_max_finish_scores(sqx_engine const * engine)
+{
+    return engine->max_finish_scores();
+}
+
+sqx_status sqx_engine_push(
+    sqx_engine * engine,
+    char const * bases,
+    size_t n,
+    float * out,
+    size_t out_size,
+    size_t * n_written)
+{
+    return guarded([&]() { *n_written = engine->push(bases, n, out, out_size); });
+}
+
+sqx_status sqx_engine_finish(sqx_engine * engine, float * out, size_t out_size, size_t * n_written)
+{
+    return guarded([&]() { *n_written = engine->finish(out, out_size); });
+}
+
+void sqx_engine_reset(sqx_engine * engine)
+{
+    engine->reset();
+}
+
+} // extern "C"